@@ -21,6 +21,17 @@ public:
         queue_.emplace(t);
     }
 
+    // Pushes a range of elements under a single lock
+    template<typename _Iterator>
+    void pushBatch(_Iterator first, _Iterator last)
+    {
+        lock_t __l(mutex_);
+        for (; first != last; ++first)
+        {
+            queue_.emplace(*first);
+        }
+    }
+
     bool tryPop(typename std::queue<T>::reference v)
     {
         lock_t __l(mutex_);
@@ -35,10 +46,11 @@ public:
 
     bool empty() const
     {
+        lock_t __l(mutex_);
         return queue_.empty();
     }
 
 private:
-    std::mutex      mutex_;
-    std::queue<T>   queue_;
+    mutable std::mutex  mutex_;
+    std::queue<T>       queue_;
 };
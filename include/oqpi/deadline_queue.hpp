@@ -0,0 +1,124 @@
+#pragma once
+
+#include <mutex>
+#include <vector>
+#include <atomic>
+#include <limits>
+#include <cstdint>
+#include <algorithm>
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Concurrent queue ordered by deadline: tryPop always returns the element with the earliest
+    // deadline, elements sharing the same deadline come out in the order they were pushed.
+    // It's a binary heap protected by a mutex, the size is kept in an atomic so that checking for
+    // emptiness, which is what consumers do most of the time, does not take the lock.
+    //
+    template<typename T>
+    class deadline_queue
+    {
+        using lock_t = std::lock_guard<std::mutex>;
+
+    public:
+        // Returned by nextDeadline when the queue is empty
+        static constexpr auto no_deadline = std::numeric_limits<int64_t>::max();
+
+    public:
+        //------------------------------------------------------------------------------------------
+        deadline_queue()
+            : size_(0)
+            , sequence_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        deadline_queue(const deadline_queue &)             = delete;
+        deadline_queue& operator =(const deadline_queue &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        void push(int64_t deadline, T &&t)
+        {
+            lock_t __l(mutex_);
+            heap_.push_back(entry{ deadline, sequence_++, std::move(t) });
+            std::push_heap(heap_.begin(), heap_.end(), later());
+            size_.store(heap_.size(), std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void push(int64_t deadline, const T &t)
+        {
+            push(deadline, T(t));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pops the element with the earliest deadline
+        bool tryPop(T &v)
+        {
+            if (empty())
+            {
+                return false;
+            }
+
+            lock_t __l(mutex_);
+            if (heap_.empty())
+            {
+                return false;
+            }
+
+            std::pop_heap(heap_.begin(), heap_.end(), later());
+            v = std::move(heap_.back().value);
+            heap_.pop_back();
+            size_.store(heap_.size(), std::memory_order_release);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Deadline of the element tryPop would return, no_deadline if there's none
+        int64_t nextDeadline() const
+        {
+            if (empty())
+            {
+                return no_deadline;
+            }
+
+            lock_t __l(mutex_);
+            return heap_.empty() ? no_deadline : heap_.front().deadline;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Approximation, only exact if the queue is not concurrently modified
+        bool empty() const
+        {
+            return size_.load(std::memory_order_acquire) == 0;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct entry
+        {
+            int64_t     deadline;
+            uint64_t    sequence;
+            T           value;
+        };
+
+        // std heaps put the greatest element first, so the latest deadline is the smallest
+        struct later
+        {
+            bool operator()(const entry &lhs, const entry &rhs) const
+            {
+                return lhs.deadline > rhs.deadline || (lhs.deadline == rhs.deadline && lhs.sequence > rhs.sequence);
+            }
+        };
+
+    private:
+        mutable std::mutex  mutex_;
+        std::vector<entry>  heap_;
+        std::atomic<size_t> size_;
+        uint64_t            sequence_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -54,29 +54,31 @@ namespace oqpi {
 
 
     //----------------------------------------------------------------------------------------------
-    template<task_type _TaskType, typename _EventType, typename _GroupContext, typename _TaskContext, typename _Scheduler, typename _Partitioner, typename _Function>
-    inline auto make_parallel_for_task_group(_Scheduler &sc, const std::string &name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
+    // The group, its tasks and the partitioner are allocated with alloc, see slab_allocator
+    template<task_type _TaskType, typename _EventType, typename _GroupContext, typename _TaskContext, typename _Allocator, typename _Scheduler, typename _Partitioner, typename _Function>
+    inline auto allocate_parallel_for_task_group(const _Allocator &alloc, _Scheduler &sc, std::string_view name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
     {
         if (!partitioner.isValid())
         {
-            return decltype(make_parallel_group<_TaskType, _GroupContext>(sc, "", prio, 0))(nullptr);
+            return decltype(allocate_task_group<parallel_group, _TaskType, _GroupContext>(alloc, sc, "", prio, 0))(nullptr);
         }
 
         const auto nbElements = partitioner.elementCount();
         const auto nbBatches  = partitioner.batchCount();
-        const auto &groupName = name + " (" + std::to_string(nbElements) + " items)";
-        auto spTaskGroup      = make_parallel_group<_TaskType, _GroupContext>(sc, groupName, prio, nbBatches);
-        auto spPartitioner    = std::make_shared<_Partitioner>(partitioner);
+        // The names are only formatted if the contexts use them
+        auto spTaskGroup      = allocate_task_group<parallel_group, _TaskType, _GroupContext>(alloc, sc, task_name(name, " (", nbElements, " items)"), prio, nbBatches);
+        auto spPartitioner    = std::allocate_shared<_Partitioner>(alloc, partitioner);
+        // The group outlives its batches, which stop taking ranges once it's cancelled
+        const auto pTaskGroup = spTaskGroup.get();
 
         for (auto batchIndex = 0; batchIndex < nbBatches; ++batchIndex)
         {
-            const auto &taskName = "Batch " + std::to_string(batchIndex + 1) + "/" + std::to_string(nbBatches);
-            auto taskHandle = make_task<task_type::fire_and_forget, _EventType, _TaskContext>(taskName, prio,
-                [batchIndex, func, spPartitioner]()
+            auto taskHandle = allocate_task<task_type::fire_and_forget, _EventType, _TaskContext>(alloc, task_name("Batch ", batchIndex + 1, "/", nbBatches), prio,
+                [batchIndex, func, spPartitioner, pTaskGroup]()
             {
                 int32_t first = 0;
                 int32_t last  = 0;
-                while (spPartitioner->getNextValidRange(first, last))
+                while (!pTaskGroup->isCancelled() && spPartitioner->getNextValidRange(first, last))
                 {
                     for (auto elementIndex = first; elementIndex != last; ++elementIndex)
                     {
@@ -91,17 +93,29 @@ namespace oqpi {
         return spTaskGroup;
     }
     //----------------------------------------------------------------------------------------------
+    template<task_type _TaskType, typename _EventType, typename _GroupContext, typename _TaskContext, typename _Scheduler, typename _Partitioner, typename _Function>
+    inline auto make_parallel_for_task_group(_Scheduler &sc, std::string_view name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
+    {
+        return allocate_parallel_for_task_group<_TaskType, _EventType, _GroupContext, _TaskContext>(std::allocator<char>(), sc, name, partitioner, prio, std::forward<_Function>(func));
+    }
+    //----------------------------------------------------------------------------------------------
 
 
     //----------------------------------------------------------------------------------------------
-    template<typename _EventType, typename _GroupContext, typename _TaskContext, typename _Scheduler, typename _Partitioner, typename _Function>
-    inline void parallel_for(_Scheduler &sc, const std::string &name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
+    template<typename _EventType, typename _GroupContext, typename _TaskContext, typename _Allocator, typename _Scheduler, typename _Partitioner, typename _Function>
+    inline void allocate_parallel_for(const _Allocator &alloc, _Scheduler &sc, std::string_view name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
     {
-        if (auto spTaskGroup = make_parallel_for_task_group<task_type::waitable, _EventType, _GroupContext, _TaskContext>(sc, name, partitioner, prio, std::forward<_Function>(func)))
+        if (auto spTaskGroup = allocate_parallel_for_task_group<task_type::waitable, _EventType, _GroupContext, _TaskContext>(alloc, sc, name, partitioner, prio, std::forward<_Function>(func)))
         {
             sc.add(task_handle(spTaskGroup)).activeWait();
         }
     }
     //----------------------------------------------------------------------------------------------
+    template<typename _EventType, typename _GroupContext, typename _TaskContext, typename _Scheduler, typename _Partitioner, typename _Function>
+    inline void parallel_for(_Scheduler &sc, std::string_view name, const _Partitioner &partitioner, task_priority prio, _Function &&func)
+    {
+        allocate_parallel_for<_EventType, _GroupContext, _TaskContext>(std::allocator<char>(), sc, name, partitioner, prio, std::forward<_Function>(func));
+    }
+    //----------------------------------------------------------------------------------------------
 
 } /*oqpi*/
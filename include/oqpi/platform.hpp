@@ -22,3 +22,18 @@
 #	undef  OQPI_PLATFORM_POSIX
 #	define OQPI_PLATFORM_POSIX	(1)
 #endif
+
+// Size of a cache line, used to pad data shared between threads to avoid false sharing
+#ifndef OQPI_CACHE_LINE_SIZE
+#   define OQPI_CACHE_LINE_SIZE (64)
+#endif
+
+// C++20 coroutines, see co_task
+#if defined(__cpp_impl_coroutine) && defined(__has_include)
+#   if __has_include(<coroutine>)
+#       define OQPI_HAS_COROUTINES (1)
+#   endif
+#endif
+#ifndef OQPI_HAS_COROUTINES
+#   define OQPI_HAS_COROUTINES (0)
+#endif
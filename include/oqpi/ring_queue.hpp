@@ -0,0 +1,318 @@
+#pragma once
+
+#include <mutex>
+#include <queue>
+#include <atomic>
+#include <iterator>
+#include <algorithm>
+#include <memory>
+#include <cstdint>
+
+#include "oqpi/platform.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Lock free bounded multi-producer/multi-consumer queue (Dmitry Vyukov's algorithm).
+    // Each slot carries a sequence number telling whether it's ready to be written or read for a
+    // given lap around the ring, so producers and consumers only contend on their own index.
+    //
+    // Overflow policy: push never fails nor blocks. When the ring is full the element is spilled
+    // to a mutex protected overflow queue. As long as the overflow queue is not empty, producers
+    // keep spilling into it so that consumers empty the ring first and then the overflow, which
+    // keeps the FIFO order and guarantees that spilled elements are not starved. Use tryPush to
+    // get a failure instead when the ring is full.
+    //
+    // _Capacity must be a power of 2.
+    //
+    template<typename T, size_t _Capacity>
+    class mpmc_ring_queue
+    {
+        static_assert(_Capacity >= 2 && (_Capacity & (_Capacity - 1)) == 0, "_Capacity must be a power of 2.");
+        static_assert(std::is_default_constructible<T>::value, "T must be default constructible.");
+
+        using lock_t = std::lock_guard<std::mutex>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        mpmc_ring_queue()
+            : enqueuePos_(0)
+            , dequeuePos_(0)
+            , cells_(new cell[_Capacity])
+            , overflowSize_(0)
+        {
+            for (size_t i = 0; i < _Capacity; ++i)
+            {
+                cells_[i].sequence.store(i, std::memory_order_relaxed);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        mpmc_ring_queue(const mpmc_ring_queue &)             = delete;
+        mpmc_ring_queue& operator =(const mpmc_ring_queue &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        void push(T &&t)
+        {
+            if (overflowSize_.load(std::memory_order_acquire) > 0 || !tryPush(std::move(t)))
+            {
+                spill(std::move(t));
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void push(const T &t)
+        {
+            push(T(t));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the ring is full, t is left untouched in that case
+        bool tryPush(T &&t)
+        {
+            auto pos = enqueuePos_.load(std::memory_order_relaxed);
+            cell *pCell = nullptr;
+            while (true)
+            {
+                pCell = &cells_[pos & mask];
+                const auto seq  = pCell->sequence.load(std::memory_order_acquire);
+                const auto dif  = intptr_t(seq) - intptr_t(pos);
+                if (dif == 0)
+                {
+                    // The slot is free for this lap, try to claim it
+                    if (enqueuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    // The slot still holds the element of the previous lap: we're full
+                    return false;
+                }
+                else
+                {
+                    // Another producer claimed it
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            pCell->value = std::move(t);
+            pCell->sequence.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes a range of elements, reserving as many consecutive free slots as possible with a
+        // single CAS at a time. The elements that still don't fit once the ring stayed full for a
+        // few attempts are spilled, following the same overflow policy as push.
+        template<typename _Iterator>
+        void pushBatch(_Iterator first, _Iterator last)
+        {
+            auto count      = size_t(std::distance(first, last));
+            auto attempts   = 0;
+            while (count > 0 && overflowSize_.load(std::memory_order_acquire) == 0)
+            {
+                const auto pushed = tryPushBatch(first, count);
+                if (pushed == 0)
+                {
+                    // Consumers can free some slots in the meantime
+                    if (++attempts >= batch_full_attempts)
+                    {
+                        break;
+                    }
+                    continue;
+                }
+                std::advance(first, pushed);
+                count   -= pushed;
+                attempts = 0;
+            }
+
+            if (count > 0)
+            {
+                spillBatch(first, last);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes the first elements of the n starting at first, as many as there are consecutive
+        // free slots, with a single CAS. Returns the number of elements pushed, 0 if the ring is
+        // full.
+        template<typename _Iterator>
+        size_t tryPushBatch(_Iterator first, size_t n)
+        {
+            auto pos = enqueuePos_.load(std::memory_order_relaxed);
+            // Slots [pos, end) are known to be free. They stay free until a producer claims them,
+            // so a failed CAS only has to check the slots past end.
+            auto end = pos;
+            while (true)
+            {
+                if (intptr_t(end - pos) < 0)
+                {
+                    end = pos;
+                }
+                while (end - pos < n && cells_[end & mask].sequence.load(std::memory_order_acquire) == end)
+                {
+                    ++end;
+                }
+
+                if (end == pos)
+                {
+                    const auto seq  = cells_[pos & mask].sequence.load(std::memory_order_acquire);
+                    const auto dif  = intptr_t(seq) - intptr_t(pos);
+                    if (dif < 0)
+                    {
+                        // The slot still holds the element of the previous lap: we're full
+                        return 0;
+                    }
+                    // Another producer claimed it
+                    pos = enqueuePos_.load(std::memory_order_relaxed);
+                }
+                else if (enqueuePos_.compare_exchange_weak(pos, end, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+
+            const auto count = size_t(end - pos);
+            for (size_t k = 0; k < count; ++k, ++first)
+            {
+                auto &c = cells_[(pos + k) & mask];
+                c.value = *first;
+                c.sequence.store(pos + k + 1, std::memory_order_release);
+            }
+            return count;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool tryPop(T &v)
+        {
+            auto pos = dequeuePos_.load(std::memory_order_relaxed);
+            cell *pCell = nullptr;
+            while (true)
+            {
+                pCell = &cells_[pos & mask];
+                const auto seq  = pCell->sequence.load(std::memory_order_acquire);
+                const auto dif  = intptr_t(seq) - intptr_t(pos + 1);
+                if (dif == 0)
+                {
+                    // The slot has been published for this lap, try to claim it
+                    if (dequeuePos_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                    {
+                        break;
+                    }
+                }
+                else if (dif < 0)
+                {
+                    // Nothing in the ring, look in the overflow
+                    return popOverflow(v);
+                }
+                else
+                {
+                    // Another consumer claimed it
+                    pos = dequeuePos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            v = std::move(pCell->value);
+            // Make sure the moved from value does not hold any resource until the slot is reused
+            pCell->value = T();
+            // Ready to be written for the next lap
+            pCell->sequence.store(pos + mask + 1, std::memory_order_release);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Approximation, only exact if the queue is not concurrently modified
+        bool empty() const
+        {
+            const auto pos = dequeuePos_.load(std::memory_order_relaxed);
+            const auto seq = cells_[pos & mask].sequence.load(std::memory_order_acquire);
+            return seq != pos + 1 && overflowSize_.load(std::memory_order_relaxed) == 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t capacity()
+        {
+            return _Capacity;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void spill(T &&t)
+        {
+            lock_t __l(overflowMutex_);
+            overflow_.emplace(std::move(t));
+            overflowSize_.fetch_add(1, std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Iterator>
+        void spillBatch(_Iterator first, _Iterator last)
+        {
+            lock_t __l(overflowMutex_);
+            size_t count = 0;
+            for (; first != last; ++first, ++count)
+            {
+                overflow_.emplace(*first);
+            }
+            overflowSize_.fetch_add(count, std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool popOverflow(T &v)
+        {
+            if (overflowSize_.load(std::memory_order_acquire) == 0)
+            {
+                return false;
+            }
+
+            lock_t __l(overflowMutex_);
+            if (overflow_.empty())
+            {
+                return false;
+            }
+
+            v = std::move(overflow_.front());
+            overflow_.pop();
+            overflowSize_.fetch_sub(1, std::memory_order_release);
+            return true;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t mask = _Capacity - 1;
+        // Number of times in a row pushBatch finds the ring full before spilling
+        static constexpr int batch_full_attempts = 4;
+
+        struct cell
+        {
+            std::atomic<size_t> sequence;
+            T                   value;
+        };
+
+    private:
+        // Producers index
+        alignas(OQPI_CACHE_LINE_SIZE) std::atomic<size_t>   enqueuePos_;
+        // Consumers index
+        alignas(OQPI_CACHE_LINE_SIZE) std::atomic<size_t>   dequeuePos_;
+        // The ring itself, only the indices above move
+        alignas(OQPI_CACHE_LINE_SIZE) std::unique_ptr<cell[]> cells_;
+        // Elements that did not fit in the ring
+        std::atomic<size_t>                                 overflowSize_;
+        std::mutex                                          overflowMutex_;
+        std::queue<T>                                       overflow_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Single parameter version so that it can be used as the task queue type of the scheduler
+    template<typename T>
+    using ring_queue = mpmc_ring_queue<T, 4096>;
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -2,9 +2,15 @@
 
 #include "oqpi/scheduling_helpers.hpp"
 #include "oqpi/scheduling/task.hpp"
+#include "oqpi/scheduling/co_task.hpp"
 #include "oqpi/scheduling/scheduler.hpp"
 #include "oqpi/scheduling/task_handle.hpp"
+#include "oqpi/scheduling/task_future.hpp"
+#include "oqpi/scheduling/continuation.hpp"
+#include "oqpi/scheduling/cancellation_token.hpp"
+#include "oqpi/scheduling/timer_wheel.hpp"
 #include "oqpi/scheduling/task_context.hpp"
 #include "oqpi/scheduling/group_context.hpp"
 #include "oqpi/scheduling/sequence_group.hpp"
 #include "oqpi/scheduling/parallel_group.hpp"
+#include "oqpi/scheduling/task_graph.hpp"
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Shared flag telling the tasks it's attached to that their work is not needed anymore, see
+    // task_base::setCancellationToken. Copies share the same flag, cancelling one cancels all.
+    //
+    // A cancelled task that has not started yet is done without running: it's discarded when
+    // popped from the queues, and groups stop scheduling their remaining tasks. A task already
+    // running is not interrupted, long running ones can poll isCancelled from their body.
+    //
+    // A default constructed token is never cancelled, use make_cancellation_token.
+    //
+    class cancellation_token
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        cancellation_token() = default;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return spCancelled_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isCancelled() const
+        {
+            return spCancelled_ && spCancelled_->load(std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void cancel() const
+        {
+            if (spCancelled_)
+            {
+                spCancelled_->store(true, std::memory_order_relaxed);
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        explicit cancellation_token(std::shared_ptr<std::atomic<bool>> spCancelled)
+            : spCancelled_(std::move(spCancelled))
+        {}
+
+        friend cancellation_token make_cancellation_token();
+
+    private:
+        std::shared_ptr<std::atomic<bool>> spCancelled_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    inline cancellation_token make_cancellation_token()
+    {
+        return cancellation_token(std::make_shared<std::atomic<bool>>(false));
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
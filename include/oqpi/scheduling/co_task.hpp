@@ -0,0 +1,649 @@
+#pragma once
+
+#include "oqpi/platform.hpp"
+
+#if OQPI_HAS_COROUTINES
+
+#include <memory>
+#include <utility>
+#include <optional>
+#include <coroutine>
+#include <exception>
+#include <type_traits>
+
+#include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_base.hpp"
+#include "oqpi/scheduling/task_handle.hpp"
+#include "oqpi/scheduling/task_future.hpp"
+#include "oqpi/scheduling/task_result.hpp"
+#include "oqpi/scheduling/task_notifier.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Implemented by the tasks running coroutines, see coroutine_task
+    class coroutine_runner
+    {
+    public:
+        virtual ~coroutine_runner() = default;
+        // The coroutine suspended at hCoroutine has to be resumed once hAwaited is done
+        virtual void resumeWhenDone(task_handle &hAwaited, std::coroutine_handle<> hCoroutine) = 0;
+        // The outermost coroutine of the task returned
+        virtual void onCoroutineDone() = 0;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    template<typename _Result>
+    class co_task;
+    //----------------------------------------------------------------------------------------------
+
+
+    namespace details {
+
+        //------------------------------------------------------------------------------------------
+        // Goes on with the awaiting coroutine right away, on the same thread, or lets the task
+        // know that its outermost coroutine returned
+        struct co_final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+            void await_resume() noexcept {}
+
+            template<typename _Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<_Promise> hCoroutine) noexcept
+            {
+                auto &promise = hCoroutine.promise();
+                if (promise.hAwaiting_)
+                {
+                    return promise.hAwaiting_;
+                }
+                promise.pRunner_->onCoroutineDone();
+                return std::noop_coroutine();
+            }
+        };
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Part of the promises that doesn't depend on the result type
+        class co_promise_base
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            // Coroutines only start once they're awaited or once their task is executed
+            std::suspend_always initial_suspend() noexcept
+            {
+                return {};
+            }
+
+            //--------------------------------------------------------------------------------------
+            co_final_awaiter final_suspend() noexcept
+            {
+                return {};
+            }
+
+            //--------------------------------------------------------------------------------------
+            // Rethrown to whoever gets the result
+            void unhandled_exception()
+            {
+                spException_ = std::current_exception();
+            }
+
+            //--------------------------------------------------------------------------------------
+            const std::exception_ptr& getException() const
+            {
+                return spException_;
+            }
+
+        protected:
+            //--------------------------------------------------------------------------------------
+            void rethrow() const
+            {
+                if (spException_)
+                {
+                    std::rethrow_exception(spException_);
+                }
+            }
+
+        public:
+            // Task resuming the coroutine, shared by every coroutine it awaits
+            coroutine_runner       *pRunner_ = nullptr;
+            // Coroutine awaiting this one, null for the outermost one
+            std::coroutine_handle<> hAwaiting_;
+
+        private:
+            std::exception_ptr      spException_;
+        };
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename _Result>
+        class co_promise
+            : public co_promise_base
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            co_task<_Result> get_return_object()
+            {
+                return co_task<_Result>(std::coroutine_handle<co_promise>::from_promise(*this));
+            }
+
+            //--------------------------------------------------------------------------------------
+            template<typename _Value>
+            void return_value(_Value &&value)
+            {
+                result_.emplace(std::forward<_Value>(value));
+            }
+
+            //--------------------------------------------------------------------------------------
+            _Result takeResult()
+            {
+                rethrow();
+                return std::move(*result_);
+            }
+
+        private:
+            // No need for the result to be default constructible
+            std::optional<_Result> result_;
+        };
+        //------------------------------------------------------------------------------------------
+        template<>
+        class co_promise<void>
+            : public co_promise_base
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            inline co_task<void> get_return_object();
+
+            //--------------------------------------------------------------------------------------
+            void return_void() {}
+
+            //--------------------------------------------------------------------------------------
+            void takeResult()
+            {
+                rethrow();
+            }
+        };
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Whether awaiting a task of type _Task gives its result, the unit tasks and the
+        // coroutine tasks have one
+        template<typename _Task, typename = void>
+        struct has_result : std::false_type {};
+        template<typename _Task>
+        struct has_result<_Task, std::void_t<decltype(std::declval<const _Task&>().getResult())>> : std::true_type {};
+
+        //------------------------------------------------------------------------------------------
+        // Suspends the awaiting coroutine until the task is done, its worker moves on to other
+        // tasks in the meantime
+        template<typename _Task>
+        class task_awaiter
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            task_awaiter(task_handle hTask, std::shared_ptr<_Task> spTask)
+                : hTask_(std::move(hTask))
+                , spTask_(std::move(spTask))
+            {}
+
+            //--------------------------------------------------------------------------------------
+            bool await_ready() const
+            {
+                return !hTask_.isValid() || hTask_.isDone();
+            }
+
+            //--------------------------------------------------------------------------------------
+            template<typename _Promise>
+            void await_suspend(std::coroutine_handle<_Promise> hCoroutine)
+            {
+                static_assert(std::is_base_of<co_promise_base, _Promise>::value, "Tasks can only be awaited from a co_task.");
+                hCoroutine.promise().pRunner_->resumeWhenDone(hTask_, hCoroutine);
+            }
+
+            //--------------------------------------------------------------------------------------
+            decltype(auto) await_resume() const
+            {
+                if constexpr (has_result<_Task>::value)
+                {
+                    return spTask_->getResult();
+                }
+            }
+
+        private:
+            task_handle             hTask_;
+            // Typed pointer to get the result, if any
+            std::shared_ptr<_Task>  spTask_;
+        };
+        //------------------------------------------------------------------------------------------
+
+        //------------------------------------------------------------------------------------------
+        // Same as task_awaiter, but the result is taken out of the task
+        template<typename _ReturnType>
+        class future_awaiter
+            : public task_awaiter<task_base>
+        {
+        public:
+            //--------------------------------------------------------------------------------------
+            future_awaiter(task_future<_ReturnType> future)
+                : task_awaiter<task_base>(future.getHandle(), nullptr)
+                , future_(std::move(future))
+            {}
+
+            //--------------------------------------------------------------------------------------
+            _ReturnType await_resume()
+            {
+                return future_.takeReady();
+            }
+
+        private:
+            task_future<_ReturnType> future_;
+        };
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Runs an awaited co_task inline, the awaiting coroutine goes on once it returns
+        template<typename _Result>
+        struct co_task_awaiter
+        {
+            std::coroutine_handle<co_promise<_Result>> hCoroutine;
+
+            bool await_ready() noexcept { return false; }
+
+            template<typename _Promise>
+            std::coroutine_handle<> await_suspend(std::coroutine_handle<_Promise> hAwaiting) noexcept
+            {
+                auto &promise       = hCoroutine.promise();
+                promise.pRunner_    = hAwaiting.promise().pRunner_;
+                promise.hAwaiting_  = hAwaiting;
+                return hCoroutine;
+            }
+
+            _Result await_resume()
+            {
+                return hCoroutine.promise().takeResult();
+            }
+        };
+        //------------------------------------------------------------------------------------------
+
+    } /*details*/
+
+
+    //----------------------------------------------------------------------------------------------
+    // Coroutine run by a coroutine_task, see helpers::schedule_coroutine. It's resumed by the
+    // workers and can co_await:
+    //  - a task_handle, or a shared pointer to any task or group, scheduled by someone. The
+    //    coroutine is suspended until it's done and its task goes back to the scheduler queues,
+    //    with its priority, once it is. Awaiting a unit task or a coroutine task gives a reference
+    //    to its result, awaiting a task_future takes the result out of the task.
+    //  - another co_task, which is run inline by the same task: the awaiting coroutine goes on
+    //    once it returns, nothing is scheduled nor allocated besides the coroutine frame.
+    //
+    // A co_task only starts when awaited or executed, and owns its coroutine frame.
+    //
+    template<typename _Result = void>
+    class [[nodiscard]] co_task
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using promise_type  = details::co_promise<_Result>;
+        using handle_type   = std::coroutine_handle<promise_type>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit co_task(handle_type hCoroutine)
+            : hCoroutine_(hCoroutine)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Movable
+        co_task(co_task &&other) noexcept
+            : hCoroutine_(std::exchange(other.hCoroutine_, nullptr))
+        {}
+
+        co_task& operator =(co_task &&rhs) noexcept
+        {
+            if (this != &rhs)
+            {
+                destroy();
+                hCoroutine_ = std::exchange(rhs.hCoroutine_, nullptr);
+            }
+            return (*this);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        co_task(const co_task &)                = delete;
+        co_task& operator =(const co_task &)    = delete;
+
+        //------------------------------------------------------------------------------------------
+        ~co_task()
+        {
+            destroy();
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return bool(hCoroutine_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        handle_type getHandle() const
+        {
+            return hCoroutine_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runs the coroutine inline from the awaiting one, on the same task
+        details::co_task_awaiter<_Result> operator co_await() && noexcept
+        {
+            return details::co_task_awaiter<_Result>{ hCoroutine_ };
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void destroy()
+        {
+            if (hCoroutine_)
+            {
+                hCoroutine_.destroy();
+                hCoroutine_ = nullptr;
+            }
+        }
+
+    private:
+        handle_type hCoroutine_;
+    };
+    //----------------------------------------------------------------------------------------------
+    inline co_task<void> details::co_promise<void>::get_return_object()
+    {
+        return co_task<void>(std::coroutine_handle<co_promise>::from_promise(*this));
+    }
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Awaiting tasks from a co_task, see co_task
+    inline auto operator co_await(task_handle hTask)
+    {
+        return details::task_awaiter<task_base>(std::move(hTask), nullptr);
+    }
+    //----------------------------------------------------------------------------------------------
+    template<typename _Task, typename = std::enable_if_t<std::is_base_of<task_base, _Task>::value>>
+    inline auto operator co_await(std::shared_ptr<_Task> spTask)
+    {
+        auto hTask = task_handle(task_sptr(spTask));
+        return details::task_awaiter<_Task>(std::move(hTask), std::move(spTask));
+    }
+    //----------------------------------------------------------------------------------------------
+    // Takes the result out of the task
+    template<typename _ReturnType>
+    inline auto operator co_await(task_future<_ReturnType> future)
+    {
+        return details::future_awaiter<_ReturnType>(std::move(future));
+    }
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Task running a co_task. Executing the task starts the coroutine, which runs until it
+    // returns or awaits a task that is not done. In the latter case the worker moves on, and the
+    // task is put back in the scheduler queues once the awaited task is done, to resume the
+    // coroutine where it left off. The task is done once its coroutine returns.
+    //
+    // The contexts see the whole coroutine as one execution, from its start to its return.
+    // A coroutine can't be restarted, so the task can't be re-armed.
+    // Cancelling the task only prevents the coroutine from starting, once started it has to
+    // check the cancellation token itself.
+    //
+    template<task_type _TaskType, typename _Scheduler, typename _EventType, typename _TaskContext, typename _Result>
+    class coroutine_task final
+        : public task_base
+        , public coroutine_runner
+        , public task_result<_Result>
+        , public _TaskContext
+        , public notifier<_TaskType, _EventType>
+        , public std::enable_shared_from_this<coroutine_task<_TaskType, _Scheduler, _EventType, _TaskContext, _Result>>
+    {
+        //------------------------------------------------------------------------------------------
+        using self_type         = coroutine_task<_TaskType, _Scheduler, _EventType, _TaskContext, _Result>;
+        using notifier_type     = notifier<_TaskType, _EventType>;
+        using task_result_type  = task_result<_Result>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        coroutine_task(_Scheduler &sc, const task_name &name, task_priority priority, co_task<_Result> coroutine)
+            : task_base(priority)
+            , _TaskContext(this, name)
+            , notifier_type()
+            , scheduler_(sc)
+            , coroutine_(std::move(coroutine))
+            , started_(false)
+            , notifyParent_(true)
+        {
+            if (coroutine_.isValid())
+            {
+                coroutine_.getHandle().promise().pRunner_ = this;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable nor movable, the coroutine points to this
+        coroutine_task(const self_type &)           = delete;
+        self_type& operator =(const self_type &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        virtual void execute() override final
+        {
+            if (oqpi_ensuref(task_base::isGrabbed(), "Trying to execute an ungrabbed task: %d", task_base::getUID()))
+            {
+                if (!started_)
+                {
+                    started_ = true;
+                    _TaskContext::task_onPreExecute();
+                    if (task_base::isCancelled())
+                    {
+                        // Cancelled before it started, the frame is dropped and there's no result
+                        coroutine_ = co_task<_Result>(typename co_task<_Result>::handle_type());
+                    }
+                    if (!coroutine_.isValid())
+                    {
+                        onCoroutineDone();
+                        return;
+                    }
+                    hResume_ = coroutine_.getHandle();
+                }
+
+                // Once suspended, the coroutine can be resumed by another worker before this
+                // returns: nothing can be touched past this point
+                std::exchange(hResume_, nullptr).resume();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Our parent runs us inline, the coroutine still needs the workers to be resumed
+        virtual void executeSingleThreaded() override final
+        {
+            if (task_base::tryGrab())
+            {
+                notifyParent_ = false;
+                execute();
+                if (!task_base::isDone())
+                {
+                    wait();
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Workers run other tasks until this one is done, see task_base::helpUntilDone
+        virtual void wait() override final
+        {
+            if constexpr (_TaskType == task_type::waitable)
+            {
+                task_base::helpUntilDone();
+            }
+            notifier_type::wait();
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void activeWait() override final
+        {
+            if (task_base::tryGrab())
+            {
+                execute();
+            }
+            if (!task_base::isDone())
+            {
+                wait();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void rearm() override final
+        {
+            oqpi_checkf(false, "A coroutine task can't be re-armed: %d", task_base::getUID());
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        virtual bool runPendingTask() override final
+        {
+            if (!task_base::isGrabbed() && task_base::tryGrab())
+            {
+                execute();
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        virtual void onParentGroupSet(const task_group_sptr &spParentGroup) override final
+        {
+            _TaskContext::task_onAddedToGroup(spParentGroup);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Reference to the result stored in the task, rethrows what escaped the coroutine
+        decltype(auto) getResult() const
+        {
+            oqpi_checkf(task_base::isDone(), "Trying to get the result of an unfinished task: %d", task_base::getUID());
+            rethrow();
+            return task_result_type::getResult();
+        }
+
+        //------------------------------------------------------------------------------------------
+        decltype(auto) waitForResult()
+        {
+            wait();
+            return getResult();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Moves the result out of the task, only once
+        _Result takeResult()
+        {
+            oqpi_checkf(task_base::isDone(), "Trying to take the result of an unfinished task: %d", task_base::getUID());
+            rethrow();
+            return task_result_type::takeResult();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Called from the coroutine, which is suspended already
+        virtual void resumeWhenDone(task_handle &hAwaited, std::coroutine_handle<> hCoroutine) override final
+        {
+            hResume_ = hCoroutine;
+            hAwaited.addContinuation([&sc = scheduler_, hSelf = task_handle(task_sptr(this->shared_from_this()))]() mutable
+            {
+                sc.resume(std::move(hSelf));
+            });
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void onCoroutineDone() override final
+        {
+            // The result is moved next to the task, where futures expect it
+            if (coroutine_.isValid())
+            {
+                auto &promise = coroutine_.getHandle().promise();
+                spException_ = promise.getException();
+                if constexpr (!std::is_void<_Result>::value)
+                {
+                    if (!spException_)
+                    {
+                        task_result_type::setResult(promise.takeResult());
+                    }
+                }
+            }
+
+            // Flag the task as done
+            task_base::setDone();
+            // Run the postExecute code of the context
+            _TaskContext::task_onPostExecute();
+            // Kick off whatever was waiting on this task
+            task_base::runContinuations();
+            // Signal that the task is done, the worker executing it still holds a reference
+            notifier_type::notify();
+            if (notifyParent_)
+            {
+                task_base::notifyParent();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void rethrow() const
+        {
+            if (spException_)
+            {
+                std::rethrow_exception(spException_);
+            }
+        }
+
+    private:
+        _Scheduler                 &scheduler_;
+        co_task<_Result>            coroutine_;
+        // What escaped the coroutine, if anything
+        std::exception_ptr          spException_;
+        // Where to resume the coroutine the next time the task is executed
+        std::coroutine_handle<>     hResume_;
+        bool                        started_;
+        // False when run inline by our parent, see executeSingleThreaded
+        bool                        notifyParent_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // The task and its control block are allocated with alloc, see slab_allocator. The coroutine
+    // frame is allocated by the compiler when the coroutine is called.
+    //
+    // Type     : user defined
+    // Context  : user defined
+    template<task_type _TaskType, typename _EventType, typename _TaskContext, typename _Allocator, typename _Scheduler, typename _Result>
+    inline auto allocate_coroutine_task(const _Allocator &alloc, _Scheduler &sc, const task_name &name, task_priority priority, co_task<_Result> coroutine)
+    {
+        using coroutine_task_type = coroutine_task<_TaskType, _Scheduler, _EventType, _TaskContext, _Result>;
+        return std::allocate_shared<coroutine_task_type>
+        (
+            alloc,
+            sc,
+            name,
+            priority,
+            std::move(coroutine)
+        );
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
+
+#endif // OQPI_HAS_COROUTINES
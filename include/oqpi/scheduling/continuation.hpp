@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <iterator>
+#include <initializer_list>
+
+#include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_handle.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Adds hNext to the scheduler once every task of the range is done, and returns it.
+    // Nobody blocks: the last task to finish adds hNext from its own thread.
+    template<typename _Scheduler, typename _Iterator>
+    inline task_handle when_all(_Scheduler &sc, _Iterator first, _Iterator last, task_handle hNext)
+    {
+        oqpi_check(hNext.isValid());
+
+        // One extra count held while registering, so that hNext is not added before we're done
+        // going through the range even if every task is already done
+        auto spRemaining = std::make_shared<std::atomic<int32_t>>(1);
+        const auto release = [&sc, spRemaining, hNext]
+        {
+            if (spRemaining->fetch_sub(1) == 1)
+            {
+                sc.add(hNext);
+            }
+        };
+
+        for (; first != last; ++first)
+        {
+            task_handle hTask = *first;
+            if (oqpi_ensuref(hTask.isValid(), "Invalid task passed to when_all"))
+            {
+                spRemaining->fetch_add(1);
+                hTask.addContinuation(release);
+            }
+        }
+
+        release();
+        return hNext;
+    }
+    //----------------------------------------------------------------------------------------------
+    template<typename _Scheduler, typename _Container>
+    inline task_handle when_all(_Scheduler &sc, const _Container &taskHandles, task_handle hNext)
+    {
+        return when_all(sc, std::begin(taskHandles), std::end(taskHandles), std::move(hNext));
+    }
+    //----------------------------------------------------------------------------------------------
+    template<typename _Scheduler>
+    inline task_handle when_all(_Scheduler &sc, std::initializer_list<task_handle> taskHandles, task_handle hNext)
+    {
+        return when_all(sc, taskHandles.begin(), taskHandles.end(), std::move(hNext));
+    }
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Adds hNext to the scheduler as soon as one task of the range is done, and returns it.
+    // Nobody blocks: the first task to finish adds hNext from its own thread.
+    template<typename _Scheduler, typename _Iterator>
+    inline task_handle when_any(_Scheduler &sc, _Iterator first, _Iterator last, task_handle hNext)
+    {
+        oqpi_check(hNext.isValid());
+
+        auto spFired = std::make_shared<std::atomic<bool>>(false);
+        const auto release = [&sc, spFired, hNext]
+        {
+            if (!spFired->exchange(true))
+            {
+                sc.add(hNext);
+            }
+        };
+
+        auto count = 0;
+        for (; first != last; ++first)
+        {
+            task_handle hTask = *first;
+            if (oqpi_ensuref(hTask.isValid(), "Invalid task passed to when_any"))
+            {
+                // No need to go further once one of them is done
+                if (!hTask.addContinuation(release))
+                {
+                    return hNext;
+                }
+                ++count;
+            }
+        }
+
+        // Nothing to wait for
+        if (count == 0)
+        {
+            release();
+        }
+        return hNext;
+    }
+    //----------------------------------------------------------------------------------------------
+    template<typename _Scheduler, typename _Container>
+    inline task_handle when_any(_Scheduler &sc, const _Container &taskHandles, task_handle hNext)
+    {
+        return when_any(sc, std::begin(taskHandles), std::end(taskHandles), std::move(hNext));
+    }
+    //----------------------------------------------------------------------------------------------
+    template<typename _Scheduler>
+    inline task_handle when_any(_Scheduler &sc, std::initializer_list<task_handle> taskHandles, task_handle hNext)
+    {
+        return when_any(sc, taskHandles.begin(), taskHandles.end(), std::move(hNext));
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_name.hpp"
 #include "oqpi/scheduling/context_container.hpp"
 
 
@@ -17,7 +18,7 @@ namespace oqpi {
     class group_context_base
     {
     public:
-        group_context_base(task_group_base *pOwner, std::string name)
+        group_context_base(task_group_base *pOwner, const task_name &)
             : pOwner_(pOwner)
         {}
 
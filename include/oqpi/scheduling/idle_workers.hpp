@@ -0,0 +1,193 @@
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+#include "oqpi/platform.hpp"
+#include "oqpi/scheduling/worker_base.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Keeps track of the workers that are about to sleep or sleeping, one bitmask per priority.
+    // A worker sets its bit in every priority it can work on right before going to sleep. To wake
+    // a worker up, the scheduler has to claim it: clear its bit and flip its idle flag. Only the
+    // one who flips the flag notifies the worker, so a sleeping worker is never woken twice and
+    // nobody is notified when all workers are busy.
+    //
+    // The worker has to check the queues again after calling setIdle and the producers have to
+    // push their task before calling wakeUp, both sides issue a full fence in between so that
+    // either the worker sees the task or the producer sees the worker.
+    //
+    class idle_workers
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        idle_workers()
+            : workerCount_(0)
+            , wordCount_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not thread safe, has to be called before the workers start
+        void resize(int32_t workerCount)
+        {
+            workerCount_    = workerCount;
+            wordCount_      = (workerCount + bits_per_word - 1) / bits_per_word;
+            idleFlags_      = std::make_unique<std::atomic<bool>[]>(size_t(workerCount_));
+            for (auto &masks : masks_)
+            {
+                masks.lines = std::make_unique<mask_line[]>(size_t((wordCount_ + words_per_line - 1) / words_per_line));
+            }
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Called by the worker itself before checking the queues one last time
+        void setIdle(const worker_base &w)
+        {
+            const auto index = w.getIndex();
+            idleFlags_[index].store(true);
+            for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+            {
+                if (w.canWorkOnPriority(task_priority(prio)))
+                {
+                    masks_[prio].word(index / bits_per_word).fetch_or(bit(index));
+                }
+            }
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by the worker itself when it wakes up or when it found a task after setIdle.
+        // Returns false if someone claimed the worker in the meantime, meaning that a notification
+        // has been or will be sent to it.
+        bool clearIdle(const worker_base &w)
+        {
+            const auto index    = w.getIndex();
+            const auto wasIdle  = idleFlags_[index].exchange(false);
+            for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+            {
+                if (w.canWorkOnPriority(task_priority(prio)))
+                {
+                    masks_[prio].word(index / bits_per_word).fetch_and(~bit(index));
+                }
+            }
+            return wasIdle;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Claims up to count idle workers able to work on the specified priority and calls
+        // notify(workerIndex) for each of them. Returns the number of workers notified.
+        template<typename _Notify>
+        int32_t wakeUp(task_priority prio, int32_t count, _Notify &&notify)
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            auto woken = 0;
+            auto &masks = masks_[int(prio)];
+            for (auto w = 0; w < wordCount_ && woken < count; ++w)
+            {
+                auto bits = masks.word(w).load(std::memory_order_relaxed);
+                while (bits != 0 && woken < count)
+                {
+                    const auto b        = lowest_bit_index(bits);
+                    const auto mask     = uint64_t(1) << b;
+                    bits &= ~mask;
+
+                    // Be the one clearing the bit, then the one flipping the flag
+                    const auto previous = masks.word(w).fetch_and(~mask);
+                    const auto index    = w * bits_per_word + b;
+                    if ((previous & mask) != 0 && idleFlags_[index].exchange(false))
+                    {
+                        notify(index);
+                        ++woken;
+                    }
+                }
+            }
+
+            return woken;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the worker at the specified index is sleeping or about to, and not claimed yet
+        bool isIdle(int32_t index) const
+        {
+            return index < workerCount_ && idleFlags_[index].load(std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Approximation of the number of workers sleeping or about to for a given priority
+        int32_t idleCount(task_priority prio) const
+        {
+            auto count = 0;
+            for (auto w = 0; w < wordCount_; ++w)
+            {
+                auto bits = masks_[int(prio)].word(w).load(std::memory_order_relaxed);
+                for (; bits != 0; bits &= bits - 1)
+                {
+                    ++count;
+                }
+            }
+            return count;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr auto PRIO_COUNT    = int32_t(task_priority::count);
+        static constexpr auto bits_per_word = 64;
+        static constexpr auto words_per_line = int32_t(OQPI_CACHE_LINE_SIZE / sizeof(uint64_t));
+
+        //------------------------------------------------------------------------------------------
+        static uint64_t bit(int32_t index)
+        {
+            return uint64_t(1) << (index % bits_per_word);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int32_t lowest_bit_index(uint64_t bits)
+        {
+#if OQPI_PLATFORM_WIN
+            unsigned long index = 0;
+            _BitScanForward64(&index, bits);
+            return int32_t(index);
+#else
+            return int32_t(__builtin_ctzll(bits));
+#endif
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // The words of each priority are on their own cache lines as they're hammered by different
+        // producers. The lines are allocated aligned, not only the pointers to them.
+        struct alignas(OQPI_CACHE_LINE_SIZE) mask_line
+        {
+            std::atomic<uint64_t> words[words_per_line];
+        };
+
+        struct priority_masks
+        {
+            std::unique_ptr<mask_line[]> lines;
+
+            std::atomic<uint64_t>& word(int32_t w)
+            {
+                return lines[w / words_per_line].words[w % words_per_line];
+            }
+
+            const std::atomic<uint64_t>& word(int32_t w) const
+            {
+                return lines[w / words_per_line].words[w % words_per_line];
+            }
+        };
+
+        int32_t                             workerCount_;
+        int32_t                             wordCount_;
+        priority_masks                      masks_[PRIO_COUNT];
+        // Whether a worker is idle and not yet claimed by anyone
+        std::unique_ptr<std::atomic<bool>[]> idleFlags_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
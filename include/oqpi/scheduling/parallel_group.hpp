@@ -2,6 +2,7 @@
 
 #include <vector>
 #include <atomic>
+#include <algorithm>
 
 #include "oqpi/scheduling/task_group.hpp"
 
@@ -26,11 +27,13 @@ namespace oqpi {
     {
     public:
         //------------------------------------------------------------------------------------------
-        parallel_group(_Scheduler &sc, const std::string &name, task_priority priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
+        parallel_group(_Scheduler &sc, const task_name &name, task_priority priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
             : task_group<_Scheduler, _TaskType, _GroupContext>(sc, name, priority)
             , activeTasksCount_(0)
             , maxSimultaneousTasks_(maxSimultaneousTasks)
             , currentTaskIndex_(1)
+            , firstPendingIndex_(0)
+            , cancelling_(false)
         {
             tasks_.reserve(taskCount);
         }
@@ -61,25 +64,11 @@ namespace oqpi {
             }
         }
 
-        //------------------------------------------------------------------------------------------
-        virtual void activeWait() override final
-        {
-            for (auto &hTask : tasks_)
-            {
-                if (hTask.tryGrab())
-                {
-                    hTask.execute();
-                }
-            }
-
-            this->wait();
-        }
-
     protected:
         //------------------------------------------------------------------------------------------
-        virtual void addTaskImpl(const task_handle &hTask) override final
+        virtual void addTaskImpl(task_handle &&hTask) override final
         {
-            tasks_.emplace_back(hTask);
+            tasks_.emplace_back(std::move(hTask));
             activeTasksCount_.fetch_add(1);
         }
 
@@ -89,19 +78,20 @@ namespace oqpi {
             const auto taskCount = tasks_.size();
             if (oqpi_ensuref(taskCount > 0, "Trying to execute an empty group"))
             {
-                size_t i = 0;
-                int32_t scheduledTasks = 0;
+                if (task_base::isCancelled())
+                {
+                    cancelPendingTasks();
+                    return;
+                }
 
-                while ((i = currentTaskIndex_.fetch_add(1)) < taskCount)
+                // The first task is executed right away, schedule the others (or as many as allowed)
+                // in one batch
+                const auto batchSize = maxSimultaneousTasks_ > 0 ? size_t(maxSimultaneousTasks_ - 1) : taskCount;
+                const auto first     = std::min(currentTaskIndex_.fetch_add(batchSize), taskCount);
+                const auto last      = std::min(first + batchSize, taskCount);
+                if (first < last)
                 {
-                    if (!tasks_[i].isGrabbed() && !tasks_[i].isDone())
-                    {
-                        this->scheduler_.add(tasks_[i]);
-                        if (maxSimultaneousTasks_ > 0 && ++scheduledTasks >= maxSimultaneousTasks_-1)
-                        {
-                            break;
-                        }
-                    }
+                    this->scheduler_.addBatch(tasks_.begin() + first, tasks_.begin() + last);
                 }
 
                 if (tasks_[0].tryGrab())
@@ -112,7 +102,44 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
-        virtual void oneTaskDone() override final
+        virtual void rearmImpl() override final
+        {
+            for (auto &hTask : tasks_)
+            {
+                hTask.rearmInGroup(this);
+            }
+            activeTasksCount_.store(tasks_.size());
+            currentTaskIndex_.store(1);
+            firstPendingIndex_.store(0);
+            cancelling_.store(false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Any task that hasn't been grabbed, scheduled or not
+        virtual bool runPendingChild() override final
+        {
+            const auto taskCount = tasks_.size();
+            auto i = firstPendingIndex_.load();
+            while (i < taskCount && tasks_[i].isGrabbed())
+            {
+                ++i;
+            }
+            // Tasks never get ungrabbed while the group runs, a stale value only means a longer scan
+            firstPendingIndex_.store(i);
+
+            for (; i < taskCount; ++i)
+            {
+                if (!tasks_[i].isGrabbed() && tasks_[i].tryGrab())
+                {
+                    tasks_[i].execute();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void oneTaskDone(const task_base &) override final
         {
             const auto previousTaskCount = activeTasksCount_.fetch_sub(1);
             if (previousTaskCount == 1)
@@ -121,19 +148,47 @@ namespace oqpi {
             }
             else if (maxSimultaneousTasks_ > 0)
             {
+                if (task_base::isCancelled())
+                {
+                    cancelPendingTasks();
+                    return;
+                }
+
                 const auto taskCount = tasks_.size();
                 size_t i = 0;
                 while ((i = currentTaskIndex_.fetch_add(1)) < taskCount)
                 {
                     if (!tasks_[i].isGrabbed() && !tasks_[i].isDone())
                     {
-                        this->scheduler_.add(tasks_[i]);
+                        this->scheduler_.post(task_handle(tasks_[i]));
                         break;
                     }
                 }
             }
         }
 
+    private:
+        //------------------------------------------------------------------------------------------
+        // The tasks not scheduled yet never will be: the ones nobody grabbed are finished on the
+        // calling thread instead, executing them only marks them as done as they're cancelled too.
+        // Only done once, as finishing a task calls oneTaskDone again.
+        void cancelPendingTasks()
+        {
+            if (!cancelling_.exchange(true))
+            {
+                // Finishing the last task releases the group
+                const auto spSelf = this->shared_from_this();
+                currentTaskIndex_.store(tasks_.size());
+                for (auto &hTask : tasks_)
+                {
+                    if (!hTask.isGrabbed() && hTask.tryGrab())
+                    {
+                        hTask.execute();
+                    }
+                }
+            }
+        }
+
     protected:
         // Number of tasks still running or yet to be run
         std::atomic<size_t>         activeTasksCount_;
@@ -143,13 +198,17 @@ namespace oqpi {
         const int32_t               maxSimultaneousTasks_;
         // Index of the next task to be scheduled
         std::atomic<size_t>         currentTaskIndex_;
+        // All the tasks before this one have been grabbed, see runPendingChild
+        std::atomic<size_t>         firstPendingIndex_;
+        // Set once the group has been found cancelled, see cancelPendingTasks
+        std::atomic<bool>           cancelling_;
     };
     //----------------------------------------------------------------------------------------------
 
     
     //----------------------------------------------------------------------------------------------
     template<task_type _TaskType, typename _GroupContext, typename _Scheduler>
-    inline auto make_parallel_group(_Scheduler &sc, const std::string &name, task_priority prio, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
+    inline auto make_parallel_group(_Scheduler &sc, const task_name &name, task_priority prio, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
     {
         return make_task_group<parallel_group, _TaskType, _GroupContext>(sc, name, prio, taskCount, maxSimultaneousTasks);
     }
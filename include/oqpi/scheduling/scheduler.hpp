@@ -1,9 +1,20 @@
 #pragma once
 
+#include <mutex>
 #include <vector>
 #include <atomic>
+#include <iterator>
+#include <algorithm>
+#include <condition_variable>
 
+#include "oqpi/deadline_queue.hpp"
+#include "oqpi/work_stealing_deque.hpp"
+#include "oqpi/threading/this_thread.hpp"
 #include "oqpi/scheduling/worker.hpp"
+#include "oqpi/scheduling/idle_workers.hpp"
+#include "oqpi/scheduling/timer_wheel.hpp"
+#include "oqpi/scheduling/scheduler_config.hpp"
+#include "oqpi/scheduling/task_fiber.hpp"
 #include "oqpi/scheduling/task_handle.hpp"
 #include "oqpi/scheduling/worker_context.hpp"
 #include "oqpi/scheduling/task_group_base.hpp"
@@ -11,6 +22,14 @@
 
 namespace oqpi {
 
+    //----------------------------------------------------------------------------------------------
+    // Default local queue type of the scheduler: workers don't have their own queues and every
+    // task goes through the shared queues.
+    template<typename>
+    struct no_local_queue {};
+    //----------------------------------------------------------------------------------------------
+
+
     //----------------------------------------------------------------------------------------------
     // The scheduler holds several task queues (one queue per priority).
     // It also holds a list of workers. It assigns tasks to workers according to priority
@@ -18,20 +37,76 @@ namespace oqpi {
     // check the queue with the highest priority first then go down to the lowest if and only if 
     // the highest priority queues are empty.
     //
-    template<template<typename> class _TaskQueueType>
+    // Optionally each worker can own a set of local queues (one per priority as well), see
+    // work_stealing_scheduler. Tasks added from a worker thread are then pushed to the local
+    // queue of that worker instead of the shared one, and idle workers steal from the others.
+    // For each priority a worker checks its own queue, then the shared queue, then tries to
+    // steal from its peers before moving on to the next priority.
+    //
+    // Workers about to sleep are tracked per priority (see idle_workers), adding a task wakes up
+    // at most one of them and nobody at all if every worker is busy.
+    //
+    // Workers are grouped into NUMA domains (see worker_config::numaNode), each domain having its
+    // own shared queues. A task goes to the domain of its preferred node if it has one (or its
+    // parent group has one), otherwise to the domain of the thread adding it. Workers go through
+    // every priority of their own domain before looking at the other domains, and a sleeping
+    // worker of another domain is only woken up when none of the task's domain is sleeping.
+    //
+    // The order in which priorities are checked depends on the priority policy, see
+    // scheduler_config.
+    //
+    // Tasks having a deadline (their own or the one of their closest parent group having one) go
+    // to queues ordered by deadline instead, one per priority, that every worker checks before
+    // anything else. Among the priorities a worker can work on, they're run earliest deadline
+    // first no matter their priority and domain. Tasks finishing after their deadline are
+    // reported, see deadline_stats and scheduler_config::onDeadlineMissed.
+    //
+    // Tasks can be pinned to a specific worker or to the workers restricted to a set of cores
+    // (see task_base::setWorkerAffinity and setCoreAffinity). Each worker has a mailbox, one
+    // queue per priority, that only it pumps from, right before the shared queue of the same
+    // priority and no matter which priorities it can work on otherwise. A task pinned to a core
+    // set goes to the mailbox of one of the matching workers, preferably a sleeping one.
+    //
+    // Delayed and periodic tasks wait in a timer_wheel driven by the workers themselves: every
+    // worker looking for a task expires the timers that are due, and the first worker going to
+    // sleep while timers are pending becomes the timekeeper, sleeping only until the next timer
+    // expires. Adding a timer that expires before the others wakes the timekeeper up, or a
+    // sleeping worker if there's none. Timers can be late by as long as every worker is busy.
+    //
+    // Workers registered with an elastic_policy come and go: the scheduler starts more of them
+    // when tasks wait for too long and lets the extra ones stop their thread once they're idle
+    // for a while. The number of workers per priority follows, see workersCount.
+    //
+    // The scheduler counts the tasks in flight: every task pushed to a queue is counted until the
+    // worker popping it is done with it, whether it ran it or found it grabbed by someone else.
+    // Waiting for the scheduler to be idle blocks until that count drops to zero, see waitIdle.
+    //
+    template<template<typename> class _TaskQueueType, template<typename> class _LocalQueueType = no_local_queue>
     class scheduler
     {
     public:
         static_assert(std::is_default_constructible<_TaskQueueType<task_handle>>::value, "_TaskQueueType must be default constructible.");
 
     public:
-        using self_type = scheduler<_TaskQueueType>;
+        using self_type = scheduler<_TaskQueueType, _LocalQueueType>;
+
+        // Whether or not workers have their own queues
+        static constexpr auto is_work_stealing = !std::is_same<_LocalQueueType<task_handle>, no_local_queue<task_handle>>::value;
 
     public:
-        scheduler()
-            : running_(false)
+        explicit scheduler(const scheduler_config &config = scheduler_config())
+            : config_(config)
+            , idleWaiters_(0)
+            , timers_(config.timerResolution.count(), now_ns())
+            , timekeeper_(-1)
+            , running_(false)
         {
-            std::memset(&workersPerPrio_[0], 0, sizeof(workersPerPrio_));
+            for (auto &count : workersPerPrio_)
+            {
+                count.store(0, std::memory_order_relaxed);
+            }
+            // There's always at least one domain
+            domains_.emplace_back(std::make_unique<domain>());
         }
 
         ~scheduler()
@@ -51,18 +126,38 @@ namespace oqpi {
         template<typename _Thread, typename _Notifier, typename _WorkerContext, typename ..._Args>
         void registerWorker(const worker_config &config, _Args &&...args)
         {
-            for (int prio = 0; prio < PRIO_COUNT; ++prio)
+            oqpi_checkf(!config.isElastic() || config.count > 0, "An elastic pool needs at least one worker: %s", config.threadAttributes.name_.c_str());
+            addWorkersPerPrio(config.workerPrio, config.count);
+
+            // Extra workers of an elastic pool are created right away, they start retired
+            auto group = -1;
+            if (config.isElastic())
             {
-                if (can_work_on_priority(config.workerPrio, task_priority(prio)))
-                {
-                    workersPerPrio_[prio] += config.count;
-                }
+                group = int32_t(elasticGroups_.size());
+                elasticGroups_.emplace_back(std::make_unique<elastic_group>(config, int32_t(workers_.size())));
+            }
+
+            oqpi_checkf(config.numaNode >= 0, "Invalid NUMA node: %d", config.numaNode);
+            const auto node = std::max(config.numaNode, 0);
+            while (int32_t(domains_.size()) <= node)
+            {
+                domains_.emplace_back(std::make_unique<domain>());
             }
 
             using worker_type = worker<_Thread, _Notifier, self_type, _WorkerContext>;
-            for (int i = 0; i < config.count; ++i)
+            for (int i = 0; i < config.maxCount(); ++i)
             {
-                workers_.emplace_back(std::make_unique<worker_type>(*this, i, config, std::forward<_Args>(args)...));
+                const auto index = int32_t(workers_.size());
+                workers_.emplace_back(std::make_unique<worker_type>(*this, i, index, config, std::forward<_Args>(args)...));
+                mailboxes_.emplace_back(std::make_unique<mailbox>());
+                // The first ones are the pool's minimum, they never retire
+                const auto isExtra = i >= config.count;
+                slots_.emplace_back(std::make_unique<worker_slot>(isExtra ? group : -1, isExtra));
+                domains_[node]->workers.push_back(index);
+                if constexpr (is_work_stealing)
+                {
+                    localQueues_.emplace_back(std::make_unique<local_queues>(index));
+                }
             }
         }
         //------------------------------------------------------------------------------------------
@@ -89,6 +184,25 @@ namespace oqpi {
             registerWorkers<_Thread, _Notifier, empty_worker_context>(configs);
         }
 
+        //------------------------------------------------------------------------------------------
+        // Changes the options of the scheduler, has to be called before start
+        void configure(const scheduler_config &config)
+        {
+            if (oqpi_ensuref(running_.load() == false, "Can't configure a running scheduler."))
+            {
+                if (config.timerResolution.count() != timers_.getResolution())
+                {
+                    timers_.reset(config.timerResolution.count(), now_ns());
+                }
+                config_ = config;
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        const scheduler_config& getConfig() const
+        {
+            return config_;
+        }
+
         //------------------------------------------------------------------------------------------
         // Check if the config is valid and start the workers
         void start()
@@ -97,14 +211,23 @@ namespace oqpi {
             {
                 for (int prio = 0; prio < PRIO_COUNT; ++prio)
                 {
-                    oqpi_checkf(workersPerPrio_[prio] > 0, "No worker for priority %d", prio);
+                    oqpi_checkf(workersPerPrio_[prio].load() > 0, "No worker for priority %d", prio);
                 }
 
+                buildPriorityOrder();
+
+                for (auto &upDomain : domains_)
+                {
+                    upDomain->idleWorkers.resize(int32_t(workers_.size()));
+                }
                 running_.store(true);
 
-                for (auto &upWorker : workers_)
+                for (auto i = 0; i < int32_t(workers_.size()); ++i)
                 {
-                    upWorker->start();
+                    if (!slots_[i]->retired.load())
+                    {
+                        workers_[i]->start();
+                    }
                 }
             }
         }
@@ -114,6 +237,10 @@ namespace oqpi {
         void stop()
         {
             running_.store(false);
+            {
+                // Waits for the worker being started, if any, nobody is started afterwards
+                lock_t __l(elasticMutex_);
+            }
 
             for (auto &upWorker : workers_)
             {
@@ -129,41 +256,50 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
-        template <class _Rep1, class _Period1, class _Rep2, class _Period2>
-        void waitUntilIdle(std::chrono::duration<_Rep1, _Period1> sleepPeriod, std::chrono::duration<_Rep2, _Period2> maxWaitTime) const
+        // Blocks until no task is left in the queues nor running. Tasks suspended on a fiber or in
+        // a coroutine count through the task they wait for, pending timers don't count.
+        // Can't be called from a worker, the task calling it would never let the count drop.
+        void waitIdle()
         {
-            const auto then = std::chrono::high_resolution_clock::now();
+            checkNotOnWorker();
+            std::unique_lock<std::mutex> __l(idleMutex_);
+            ++idleWaiters_;
+            idleCondition_.wait(__l, [this] { return isIdle(); });
+            --idleWaiters_;
+        }
 
-            while (!isIdle())
-            {
-                this_thread::sleep_for(sleepPeriod);
-                if (std::chrono::high_resolution_clock::now() - then > maxWaitTime)
-                {
-                    break;
-                }
-            }
+        //------------------------------------------------------------------------------------------
+        // Same as waitIdle but gives up after maxWaitTime, returns whether the scheduler is idle
+        template<typename _Rep, typename _Period>
+        bool waitIdleFor(std::chrono::duration<_Rep, _Period> maxWaitTime)
+        {
+            checkNotOnWorker();
+            std::unique_lock<std::mutex> __l(idleMutex_);
+            ++idleWaiters_;
+            const auto idle = idleCondition_.wait_for(__l, maxWaitTime, [this] { return isIdle(); });
+            --idleWaiters_;
+            return idle;
         }
 
         //------------------------------------------------------------------------------------------
-        bool isIdle() const
+        // Kept for compatibility, the sleep period is not used anymore, see waitIdleFor
+        template <class _Rep1, class _Period1, class _Rep2, class _Period2>
+        void waitUntilIdle(std::chrono::duration<_Rep1, _Period1>, std::chrono::duration<_Rep2, _Period2> maxWaitTime)
         {
-            for (const auto &taskQueue : pendingTasks_)
-            {
-                if (!taskQueue.empty())
-                {
-                    return false;
-                }
-            }
+            waitIdleFor(maxWaitTime);
+        }
 
-            for (const auto &upWorker : workers_)
-            {
-                if (!upWorker->isAvailable())
-                {
-                    return false;
-                }
-            }
+        //------------------------------------------------------------------------------------------
+        bool isIdle() const
+        {
+            return inFlightCount() == 0;
+        }
 
-            return true;
+        //------------------------------------------------------------------------------------------
+        // Number of tasks queued or running, see waitIdle
+        int64_t inFlightCount() const
+        {
+            return inFlight_.count.load();
         }
 
         //------------------------------------------------------------------------------------------
@@ -173,32 +309,226 @@ namespace oqpi {
             return int(workers_.size());
         }
         //------------------------------------------------------------------------------------------
+        // Idle statistics of the worker at the specified index, see idle_policy
+        idle_stats workerIdleStats(int32_t workerIndex) const
+        {
+            oqpi_checkf(workerIndex >= 0 && workerIndex < workersTotalCount(), "Invalid worker index: %d", workerIndex);
+            return workers_[workerIndex]->getIdleStats();
+        }
+        //------------------------------------------------------------------------------------------
+        // Time spent in the queues by the tasks of the specified priority, only measured if the
+        // scheduler tracks wait times
+        priority_wait_stats waitStats(task_priority prio) const
+        {
+            oqpi_checkf(prio < task_priority::count, "Invalid priority: %d", int(prio));
+            const auto &counters = waitCounters_[int(prio)];
+            priority_wait_stats stats;
+            stats.count     = counters.count.load(std::memory_order_relaxed);
+            stats.totalNs   = counters.totalNs.load(std::memory_order_relaxed);
+            stats.maxNs     = counters.maxNs.load(std::memory_order_relaxed);
+            return stats;
+        }
+        //------------------------------------------------------------------------------------------
+        void resetWaitStats()
+        {
+            for (auto &counters : waitCounters_)
+            {
+                counters.count.store(0, std::memory_order_relaxed);
+                counters.totalNs.store(0, std::memory_order_relaxed);
+                counters.maxNs.store(0, std::memory_order_relaxed);
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        // Outcome of the tasks having a deadline executed so far
+        deadline_stats deadlineStats() const
+        {
+            deadline_stats stats;
+            stats.count         = deadlineCounters_.count.load(std::memory_order_relaxed);
+            stats.missed        = deadlineCounters_.missed.load(std::memory_order_relaxed);
+            stats.maxLatenessNs = deadlineCounters_.maxLatenessNs.load(std::memory_order_relaxed);
+            return stats;
+        }
+        //------------------------------------------------------------------------------------------
+        void resetDeadlineStats()
+        {
+            deadlineCounters_.count.store(0, std::memory_order_relaxed);
+            deadlineCounters_.missed.store(0, std::memory_order_relaxed);
+            deadlineCounters_.maxLatenessNs.store(0, std::memory_order_relaxed);
+        }
+        //------------------------------------------------------------------------------------------
+        // Number of NUMA domains, one per node up to the highest node a worker was registered on
+        int domainsCount() const
+        {
+            return int(domains_.size());
+        }
+        //------------------------------------------------------------------------------------------
         // Number of workers registered for the specified priority.
         // Note that the sum of workers for each priority does not necessarily equal the workers
         // total count as the same worker can be registered for several priorities.
         int workersCount(task_priority prio) const
         {
             oqpi_checkf(prio < task_priority::count, "Invalid priority: %d", int(prio));
-            return prio < task_priority::count ? workersPerPrio_[int(prio)] : 0;
+            return prio < task_priority::count ? workersPerPrio_[int(prio)].load(std::memory_order_relaxed) : 0;
+        }
+        //------------------------------------------------------------------------------------------
+        // Number of workers whose thread is running, the retired workers of the elastic pools
+        // are not counted
+        int workersActiveCount() const
+        {
+            auto count = 0;
+            for (const auto &upSlot : slots_)
+            {
+                count += upSlot->retired.load(std::memory_order_relaxed) ? 0 : 1;
+            }
+            return count;
         }
 
         //------------------------------------------------------------------------------------------
         // Pushes a task handle in the queue and returns the same passed handle.
         // The handle is warrantied to be valid at the return of this function, even if the task
         // completed in the meantime.
-        // It also signals all workers able to work on the task's priority.
+        // When work stealing is enabled and this is called from one of our workers, the task goes
+        // to that worker's local queue.
+        // Tasks pinned to a worker go to its mailbox and wake it up.
+        // Tasks having a deadline go to the deadline queue.
+        // It also wakes up one sleeping worker able to work on the task's priority.
+        // The passed handle is moved to the queue and the returned one is copied beforehand, a
+        // handle passed as an rvalue costs a single reference count increment.
         task_handle add(task_handle hTask)
         {
-            if (hTask.isValid() && !hTask.isGrabbed() && !hTask.isDone())
+            auto hResult = hTask;
+            enqueue(std::move(hTask));
+            return hResult;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as add but the handle is moved all the way to the worker running the task instead
+        // of being handed back, so the reference count of the task is not touched. That's the way
+        // to go for fire_and_forget tasks.
+        void post(task_handle &&hTask)
+        {
+            enqueue(std::move(hTask));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Puts back in the queues a task that suspended itself while waiting for another one, see
+        // task_fiber and coroutine_task. The task is still grabbed, the worker popping it takes
+        // its resume token instead.
+        void resume(task_handle hTask)
+        {
+            hTask.setResumable();
+            dispatch(std::move(hTask));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes a range of task handles, each queue involved is only hit once (one lock or one
+        // reservation depending on the queue) and at most one worker per task is woken up.
+        // Tasks pinned to a worker or having a deadline are pushed one by one to the mailboxes
+        // and the deadline queue.
+        // Tasks that are not valid, already grabbed or done are skipped like with add.
+        template<typename _Iterator>
+        void addBatch(_Iterator first, _Iterator last)
+        {
+            // Sort the tasks per domain and priority, the buffers are reused from one call to the other
+            const auto domainCount = int32_t(domains_.size());
+            auto &batch = this_thread_batch();
+            if (int32_t(batch.size()) < domainCount * PRIO_COUNT)
             {
-                const auto priority = resolveTaskPriority(hTask);
-                pendingTasks_[int(priority)].push(hTask);
-                wakeUpWorkersWithPriority(priority);
+                batch.resize(domainCount * PRIO_COUNT);
             }
-            return hTask;
+
+            for (; first != last; ++first)
+            {
+                const task_handle &hTask = *first;
+                if (hTask.isValid() && !hTask.isGrabbed() && !hTask.isDone())
+                {
+                    inFlight_.count.fetch_add(1);
+                    const auto prio = int32_t(resolveTaskPriority(hTask));
+                    stampEnqueueTime(hTask);
+                    if (pushToMailbox(hTask, task_priority(prio)))
+                    {
+                        continue;
+                    }
+
+                    const auto node = resolveTaskDomain(hTask);
+                    if (resolveTaskDeadline(hTask))
+                    {
+                        deadlineTasks_[prio].push(hTask.getDeadline(), hTask);
+                        wakeUpWorkers(node, task_priority(prio), 1);
+                    }
+                    else
+                    {
+                        batch[node * PRIO_COUNT + prio].emplace_back(hTask);
+                    }
+                }
+            }
+
+            for (auto node = 0; node < domainCount; ++node)
+            {
+                for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+                {
+                    auto &tasks = batch[node * PRIO_COUNT + prio];
+                    if (!tasks.empty())
+                    {
+                        const auto taskCount = int32_t(tasks.size());
+                        pushBatch(tasks, task_priority(prio), node);
+                        wakeUpWorkers(node, task_priority(prio), taskCount);
+                        tasks.clear();
+                    }
+                }
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename _Container>
+        void addBatch(const _Container &taskHandles)
+        {
+            addBatch(std::begin(taskHandles), std::end(taskHandles));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Adds the task once the specified time is reached (rounded up to the timer resolution).
+        // The returned handle can be used to cancel it until then.
+        timer_handle addAt(std::chrono::steady_clock::time_point time, task_handle hTask)
+        {
+            oqpi_check(hTask.isValid());
+            auto spTimer = std::make_shared<timer_entry>(timers_, std::move(hTask), nullptr, 0);
+            addTimer(spTimer, to_ns(time), 0);
+            return timer_handle(std::move(spTimer));
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename _Rep, typename _Period>
+        timer_handle addAfter(std::chrono::duration<_Rep, _Period> delay, task_handle hTask)
+        {
+            return addAt(std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(delay), std::move(hTask));
+        }
+        //------------------------------------------------------------------------------------------
+        // Adds a new task created by makeTask every period, starting one period from now, until
+        // the returned handle is cancelled. makeTask is called by the worker expiring the timer.
+        template<typename _Rep, typename _Period>
+        timer_handle addPeriodic(std::chrono::duration<_Rep, _Period> period, std::function<task_handle()> makeTask)
+        {
+            const auto periodNs = std::chrono::duration_cast<std::chrono::nanoseconds>(period).count();
+            oqpi_checkf(periodNs > 0, "Invalid period: %lld", (long long)periodNs);
+            oqpi_check(makeTask != nullptr);
+            auto spTimer = std::make_shared<timer_entry>(timers_, task_handle(), std::move(makeTask), 0);
+            addTimer(spTimer, now_ns() + periodNs, periodNs);
+            return timer_handle(std::move(spTimer));
+        }
+        //------------------------------------------------------------------------------------------
+        // Number of delayed and periodic tasks waiting for their time
+        size_t pendingTimersCount() const
+        {
+            return timers_.size();
         }
 
     private:
+        //------------------------------------------------------------------------------------------
+        static const auto PRIO_COUNT = int32_t(task_priority::count);
+
+        //------------------------------------------------------------------------------------------
+        // Defined below
+        struct domain;
+
         //------------------------------------------------------------------------------------------
         // Get the actual priority of the task, task items can be set to inherit so they take the
         // priority of their owning group
@@ -208,7 +538,7 @@ namespace oqpi {
 
             if (priority == task_priority::inherit)
             {
-                auto pParentGroup = hTask.getParentGroup().get();
+                auto pParentGroup = hTask.getParentGroup();
                 do 
                 {
                     if (oqpi_failedf(pParentGroup != nullptr, "One parent group is invalid for this task: %d", hTask.getUID()))
@@ -218,7 +548,7 @@ namespace oqpi {
                     }
 
                     priority     = pParentGroup->getPriority();
-                    pParentGroup = pParentGroup->getParentGroup().get();
+                    pParentGroup = pParentGroup->getParentGroup();
 
                 } while (priority == task_priority::inherit);
             }
@@ -227,119 +557,1298 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
-        // Retrieve a task to work on
-        task_handle waitForNextTask(worker_base &w)
+        // Get the domain the task should be pushed to: its preferred node, the one of its closest
+        // parent group having one, or the node of the calling thread
+        int32_t resolveTaskDomain(const task_handle &hTask) const
         {
-            const auto pumpTask = [this, &w](task_handle &hTask)
+            const auto domainCount = int32_t(domains_.size());
+            if (domainCount == 1)
             {
-                if (!running_.load())
+                return 0;
+            }
+
+            auto node = hTask.getPreferredNode();
+            for (auto pParentGroup = hTask.getParentGroup(); node < 0 && pParentGroup != nullptr; pParentGroup = pParentGroup->getParentGroup())
+            {
+                node = pParentGroup->getPreferredNode();
+            }
+
+            if (node < 0)
+            {
+                const auto workerIndex = currentWorkerIndex();
+                node = workerIndex >= 0 ? workers_[workerIndex]->getNumaNode() : this_thread_numa_node();
+            }
+
+            return node % domainCount;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the task has a deadline, either its own or the one of its closest parent group
+        // having one. An inherited deadline is copied to the task so that it can be checked once
+        // the task is executed.
+        bool resolveTaskDeadline(const task_handle &hTask) const
+        {
+            auto deadline = hTask.getDeadline();
+            for (auto pParentGroup = hTask.getParentGroup(); deadline <= 0 && pParentGroup != nullptr; pParentGroup = pParentGroup->getParentGroup())
+            {
+                deadline = pParentGroup->getDeadline();
+            }
+
+            if (deadline <= 0)
+            {
+                return false;
+            }
+
+            if (deadline != hTask.getDeadline())
+            {
+                const_cast<task_handle&>(hTask).setDeadline(deadline);
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Index of the worker the task is pinned to: the one it asked for, or one of the workers
+        // restricted to its core set, the sleeping ones first. -1 if the task can go anywhere.
+        int32_t resolveTaskWorker(const task_handle &hTask)
+        {
+            const auto workerCount = int32_t(workers_.size());
+            const auto workerIndex = hTask.getWorkerAffinity();
+            if (workerIndex >= 0)
+            {
+                if (oqpi_ensuref(workerIndex < workerCount, "Invalid worker affinity: %d", workerIndex))
                 {
-                    return true;
+                    return workerIndex;
                 }
+                return -1;
+            }
 
-                for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+            const auto cores = uint32_t(hTask.getCoreAffinity());
+            if (cores == uint32_t(core_affinity::all_cores))
+            {
+                return -1;
+            }
+
+            // Round robin among the matching workers, unless one of them is sleeping
+            const auto first = int32_t(nextPinnedWorker_.fetch_add(1, std::memory_order_relaxed) % uint32_t(std::max(workerCount, 1)));
+            auto candidate = -1;
+            for (auto i = 0; i < workerCount; ++i)
+            {
+                const auto index = (first + i) % workerCount;
+                const auto &w = *workers_[index];
+                if ((uint32_t(w.getConfig().threadAttributes.coreAffinityMask_) & ~cores) == 0)
                 {
-                    if (w.canWorkOnPriority(task_priority(prio)))
+                    if (domains_[w.getNumaNode()]->idleWorkers.isIdle(index))
                     {
-                        while (pendingTasks_[prio].tryPop(hTask))
-                        {
-                            // We got a task, try to grab it to ensure that we can work on it
-                            // Note that a task_group can be done without being grabbed when calling activeWait
-                            if (hTask.tryGrab() && !hTask.isDone())
-                            {
-                                // We got the go to start working on the current task
-                                return true;
-                            }
-                            else
-                            {
-                                // The task has already been grabbed by someone else
-                                hTask.reset();
-                            }
-                        }
+                        return index;
+                    }
+                    // A retired worker only if there's no other choice, see pushToMailbox
+                    if (candidate < 0 || (slots_[candidate]->retired.load() && !slots_[index]->retired.load()))
+                    {
+                        candidate = index;
                     }
                 }
+            }
 
-                return false;
-            };
-
-            // Before checking if we have a task decrement the semaphore count until it reaches 0
-            while (w.tryWait());
+            oqpi_checkf(candidate >= 0, "No worker restricted to the cores 0x%x", cores);
+            return candidate;
+        }
 
-            task_handle hTask;
-            while (!pumpTask(hTask))
+        //------------------------------------------------------------------------------------------
+        // See add and post, the handle is copied or moved to the queue depending on _TaskHandle
+        template<typename _TaskHandle>
+        void enqueue(_TaskHandle &&hTask)
+        {
+            if (hTask.isValid() && !hTask.isGrabbed() && !hTask.isDone())
             {
-                w.wait();
-                while (w.tryWait());
+                dispatch(std::forward<_TaskHandle>(hTask));
             }
-
-            return hTask;
         }
 
-    public:
         //------------------------------------------------------------------------------------------
-        // Called by worker threads when they are available, this function blocks on a semaphore.
-        // Once it receives a token it proceeds to getting a valid task from the queue.
-        void signalAvailableWorker(worker_base &w)
+        // Sends the task to the queue it belongs to and wakes up a worker to run it
+        template<typename _TaskHandle>
+        void dispatch(_TaskHandle &&hTask)
         {
-            // Loop until we find a task to work on
-            while (true)
+            // Counted before being pushed, a worker could pop it right away
+            inFlight_.count.fetch_add(1);
+            const auto priority = resolveTaskPriority(hTask);
+            stampEnqueueTime(hTask);
+            if (pushToMailbox(std::forward<_TaskHandle>(hTask), priority))
             {
-                // Grab the next task
-                task_handle hTask = waitForNextTask(w);
+                return;
+            }
 
-                // We could have been waken up to stop
-                if (!running_.load())
-                {
-                    return;
-                }
+            const auto node     = resolveTaskDomain(hTask);
+            if (resolveTaskDeadline(hTask))
+            {
+                const auto deadline = hTask.getDeadline();
+                deadlineTasks_[int(priority)].push(deadline, std::forward<_TaskHandle>(hTask));
+            }
+            else
+            {
+                push(std::forward<_TaskHandle>(hTask), priority, node);
+            }
 
-                // Make sure it's runnable
-                if (oqpi_ensure(hTask.isValid() && hTask.isGrabbed()))
+            // A handle we moved from can't tell whether its task has been grabbed already
+            if constexpr (std::is_lvalue_reference<_TaskHandle>::value)
+            {
+                if (hTask.isGrabbed())
                 {
-                    // Make sure it's not done (activeWait on groups can leave a task done without being grabbed)
-                    if (!hTask.isDone())
-                    {
-                        // Assign it to the available worker
-                        w.assign(std::move(hTask));
-
-                        // We got a task! See ya!
-                        break;
-                    }
+                    return;
                 }
             }
+            wakeUpWorkers(node, priority, 1);
         }
 
-    private:
         //------------------------------------------------------------------------------------------
-        // Signal all workers
-        void wakeUpAllWorkers()
+        // Whether the task runs on a fiber, because it asked for it or because its closest parent
+        // group asking for it does. Like the deadline, an inherited flag is copied to the task.
+        bool resolveTaskFiber(task_handle &hTask) const
         {
-            for (auto &upWorker : workers_)
+            auto runOnFiber = hTask.getRunOnFiber();
+            for (auto pParentGroup = hTask.getParentGroup(); !runOnFiber && pParentGroup != nullptr; pParentGroup = pParentGroup->getParentGroup())
             {
-                upWorker->notify();
+                runOnFiber = pParentGroup->getRunOnFiber();
             }
 
+            if (runOnFiber && !hTask.getRunOnFiber())
+            {
+                hTask.setRunOnFiber(true);
+            }
+            return runOnFiber;
         }
-        // Signal only the workers of the specified priority
-        void wakeUpWorkersWithPriority(task_priority prio)
+
+        //------------------------------------------------------------------------------------------
+        // Starts or resumes the task on its fiber. If it suspends, it's requeued as soon as the
+        // task it waits for is done, with a resume token as it's still grabbed. Otherwise it's
+        // done and the fiber goes back to the pool.
+        void executeOnFiber(task_handle &hTask)
         {
-            for (auto &upWorker : workers_)
+            auto pFiber = static_cast<task_fiber*>(hTask.getFiber());
+            if (pFiber == nullptr)
             {
-                if (upWorker->canWorkOnPriority(prio))
+                pFiber = fibers_.acquire(config_.fiberStackSize);
+                if (pFiber == nullptr)
                 {
-                    upWorker->notify();
+                    // Out of memory for stacks, the task will block its worker when waiting
+                    hTask.execute();
+                    return;
                 }
+                pFiber->assign(hTask);
+                hTask.setFiber(pFiber);
             }
-        }
 
-    private:
-        static const auto PRIO_COUNT = int32_t(task_priority::count);
+            if (const auto pAwaited = pFiber->run())
+            {
+                pAwaited->addContinuation([this, hTask]() mutable
+                {
+                    resume(std::move(hTask));
+                });
+                return;
+            }
 
-        std::vector<worker_uptr>    workers_;
-        int32_t                     workersPerPrio_[PRIO_COUNT];
-        _TaskQueueType<task_handle> pendingTasks_[PRIO_COUNT];
-        std::atomic<bool>           running_;
+            hTask.setFiber(nullptr);
+            fibers_.release(pFiber);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes the task to the mailbox of the worker it's pinned to and wakes it up.
+        // Returns false if the task is not pinned, hTask is left untouched in that case.
+        template<typename _TaskHandle>
+        bool pushToMailbox(_TaskHandle &&hTask, task_priority priority)
+        {
+            const auto workerIndex = resolveTaskWorker(hTask);
+            if (workerIndex < 0)
+            {
+                return false;
+            }
+
+            auto &box = *mailboxes_[workerIndex];
+            box.tasks[int(priority)].push(std::forward<_TaskHandle>(hTask));
+            box.pending.fetch_add(1);
+            // The worker is notified no matter what, it's the only one able to run the task.
+            // A retired one is started again, see tryRetire for the other side.
+            workers_[workerIndex]->notify();
+            if (slots_[workerIndex]->retired.load())
+            {
+                lock_t __l(elasticMutex_);
+                restartWorker(workerIndex);
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // NUMA node of the calling thread, only queried once per thread as it's a system call on
+        // some platforms. Threads are not expected to move across nodes.
+        static int32_t this_thread_numa_node()
+        {
+            static thread_local const auto node = int32_t(this_thread::get_current_numa_node());
+            return node;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int64_t now_ns()
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+        }
+        //------------------------------------------------------------------------------------------
+        static int64_t to_ns(std::chrono::steady_clock::time_point time)
+        {
+            return std::chrono::duration_cast<std::chrono::nanoseconds>(time.time_since_epoch()).count();
+        }
+        //------------------------------------------------------------------------------------------
+        void stampEnqueueTime(const task_handle &hTask) const
+        {
+            if (config_.trackWaitTimes || !elasticGroups_.empty())
+            {
+                const_cast<task_handle&>(hTask).setEnqueueTime(now_ns());
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        void recordWaitTime(int prio, const task_handle &hTask)
+        {
+            const auto waitNs   = uint64_t(std::max<int64_t>(now_ns() - hTask.getEnqueueTime(), 0));
+            auto &counters      = waitCounters_[prio];
+            counters.count.fetch_add(1, std::memory_order_relaxed);
+            counters.totalNs.fetch_add(waitNs, std::memory_order_relaxed);
+            auto maxNs = counters.maxNs.load(std::memory_order_relaxed);
+            while (waitNs > maxNs && !counters.maxNs.compare_exchange_weak(maxNs, waitNs, std::memory_order_relaxed));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Builds the sequence of priorities workers start their search from with the weighted
+        // policy (smooth weighted round robin, so that each priority is spread over the sequence)
+        void buildPriorityOrder()
+        {
+            priorityOrder_.clear();
+            if (config_.priorityPolicy != priority_policy::weighted)
+            {
+                return;
+            }
+
+            int32_t totalWeight = 0;
+            int32_t current[PRIO_COUNT] = {};
+            for (const auto weight : config_.priorityWeights)
+            {
+                oqpi_checkf(weight > 0, "Invalid priority weight: %d", weight);
+                totalWeight += std::max(weight, 1);
+            }
+
+            for (auto i = 0; i < totalWeight; ++i)
+            {
+                auto best = 0;
+                for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+                {
+                    current[prio] += std::max(config_.priorityWeights[prio], 1);
+                    if (current[prio] > current[best])
+                    {
+                        best = prio;
+                    }
+                }
+                current[best] -= totalWeight;
+                priorityOrder_.push_back(best);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Fills the order in which the worker should check the priorities for its next task
+        void priorityScanOrder(worker_base &w, int32_t (&prios)[PRIO_COUNT]) const
+        {
+            auto first = 0;
+            if (!priorityOrder_.empty())
+            {
+                first = priorityOrder_[w.nextPriorityCursor() % uint32_t(priorityOrder_.size())];
+            }
+
+            // The picked priority, then the others from the highest to the lowest
+            prios[0] = first;
+            for (auto prio = 0, i = 1; prio < PRIO_COUNT; ++prio)
+            {
+                if (prio != first)
+                {
+                    prios[i++] = prio;
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the calling thread is one of our workers, belonging to the specified domain and
+        // able to work on the specified priority. Returns its index if that's the case, -1 otherwise.
+        int32_t localWorkerIndex(task_priority priority, int32_t node) const
+        {
+            const auto workerIndex = currentWorkerIndex();
+            if (workerIndex >= 0)
+            {
+                const auto &w = *workers_[workerIndex];
+                if (w.getNumaNode() == node && w.canWorkOnPriority(priority))
+                {
+                    return workerIndex;
+                }
+            }
+            return -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Pushes the task to the local queue of the calling worker if possible, otherwise to the
+        // shared queue of its domain and priority
+        template<typename _TaskHandle>
+        void push(_TaskHandle &&hTask, task_priority priority, int32_t node)
+        {
+            if constexpr (is_work_stealing)
+            {
+                const auto workerIndex = localWorkerIndex(priority, node);
+                if (workerIndex >= 0)
+                {
+                    localQueues_[workerIndex]->tasks[int(priority)].push(std::forward<_TaskHandle>(hTask));
+                    return;
+                }
+            }
+
+            domains_[node]->tasks[int(priority)].push(std::forward<_TaskHandle>(hTask));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as push for a list of tasks of the same priority, the tasks are moved from
+        void pushBatch(std::vector<task_handle> &tasks, task_priority priority, int32_t node)
+        {
+            if constexpr (is_work_stealing)
+            {
+                const auto workerIndex = localWorkerIndex(priority, node);
+                if (workerIndex >= 0)
+                {
+                    push_batch(localQueues_[workerIndex]->tasks[int(priority)], tasks, 0);
+                    return;
+                }
+            }
+
+            push_batch(domains_[node]->tasks[int(priority)], tasks, 0);
+        }
+        //------------------------------------------------------------------------------------------
+        // Queues providing pushBatch
+        template<typename _Queue>
+        static auto push_batch(_Queue &queue, std::vector<task_handle> &tasks, int)
+            -> decltype(queue.pushBatch(std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end())), void())
+        {
+            queue.pushBatch(std::make_move_iterator(tasks.begin()), std::make_move_iterator(tasks.end()));
+        }
+        //------------------------------------------------------------------------------------------
+        // Any other queue, one push per task
+        template<typename _Queue>
+        static void push_batch(_Queue &queue, std::vector<task_handle> &tasks, long)
+        {
+            for (auto &hTask : tasks)
+            {
+                queue.push(std::move(hTask));
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the deadline queue, the shared queue or any local queue of the specified priority
+        // has tasks left. Approximation, as the queues are concurrently modified.
+        bool hasPendingTasks(int prio) const
+        {
+            if (!deadlineTasks_[prio].empty())
+            {
+                return true;
+            }
+
+            for (const auto &upDomain : domains_)
+            {
+                if (!upDomain->tasks[prio].empty())
+                {
+                    return true;
+                }
+            }
+
+            if constexpr (is_work_stealing)
+            {
+                for (const auto &upLocalQueues : localQueues_)
+                {
+                    if (!upLocalQueues->tasks[prio].empty())
+                    {
+                        return true;
+                    }
+                }
+            }
+
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Index of the worker of this scheduler running on the calling thread, -1 if the calling
+        // thread is not one of our workers
+        int32_t currentWorkerIndex() const
+        {
+            const auto &cw = this_worker();
+            return cw.pScheduler == this ? cw.index : -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // A queued task is done with, the threads waiting for the scheduler to be idle are woken
+        // up when it was the last one. Taking the lock ensures they're either asleep or yet to
+        // check the count.
+        void releaseInFlight()
+        {
+            if (inFlight_.count.fetch_sub(1) == 1 && idleWaiters_.load() > 0)
+            {
+                lock_t __l(idleMutex_);
+                idleCondition_.notify_all();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void checkNotOnWorker() const
+        {
+            oqpi_checkf(currentWorkerIndex() < 0, "Waiting for the scheduler to be idle from one of its workers: %d", currentWorkerIndex());
+        }
+
+        //------------------------------------------------------------------------------------------
+        struct current_worker
+        {
+            const self_type *pScheduler = nullptr;
+            int32_t          index      = -1;
+        };
+        static current_worker& this_worker()
+        {
+            static thread_local current_worker cw;
+            return cw;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Tries to steal a task of the specified priority from the local queue of another worker
+        // of the specified domain.
+        // Victims are visited in a round robin fashion starting from a random one.
+        bool steal(worker_base &w, const domain &victims, int prio, task_handle &hTask)
+        {
+            const auto workerCount = int32_t(victims.workers.size());
+            if (workerCount > 0)
+            {
+                auto &thief     = *localQueues_[w.getIndex()];
+                const auto from = int32_t(thief.nextRandom() % uint32_t(workerCount));
+                for (auto i = 0; i < workerCount; ++i)
+                {
+                    const auto victimIndex = victims.workers[(from + i) % workerCount];
+                    if (victimIndex != w.getIndex())
+                    {
+                        auto &victimQueue = localQueues_[victimIndex]->tasks[prio];
+                        // A failed steal means someone else took a task, keep trying until it's empty
+                        while (!victimQueue.empty())
+                        {
+                            if (victimQueue.trySteal(hTask))
+                            {
+                                return true;
+                            }
+                        }
+                    }
+                }
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Retrieve a task to work on. When the worker can't idle, an invalid handle is returned
+        // right away if there's nothing to do.
+        task_handle waitForNextTask(worker_base &w, bool canIdle = true)
+        {
+            // Try to grab the task to ensure that we can work on it.
+            // Note that a task_group can be done without being grabbed when calling activeWait
+            const auto grab = [this](task_handle &hTask, int prio)
+            {
+                // Tasks suspended on a fiber are still grabbed, they have a resume token instead
+                auto grabbed = hTask.tryGrab();
+                if (grabbed && !hTask.isDone() && hTask.isCancelled())
+                {
+                    // Discarded: executing a cancelled task only marks it as done, groups finish
+                    // their tasks the same way without scheduling them
+                    hTask.execute();
+                    grabbed = false;
+                }
+
+                if ((grabbed || hTask.tryResume()) && !hTask.isDone())
+                {
+                    // We got the go to start working on the current task
+                    if (config_.trackWaitTimes)
+                    {
+                        recordWaitTime(prio, hTask);
+                    }
+                    if (!elasticGroups_.empty())
+                    {
+                        checkWaitThreshold(prio, hTask);
+                    }
+                    return true;
+                }
+
+                // The task has already been grabbed by someone else
+                hTask.reset();
+                releaseInFlight();
+                return false;
+            };
+
+            // Takes a task from the shared queue or the local queues of a domain
+            const auto pumpDomain = [this, &w, &grab](const int32_t node, int prio, task_handle &hTask)
+            {
+                auto &d = *domains_[node];
+                while (d.tasks[prio].tryPop(hTask))
+                {
+                    if (grab(hTask, prio))
+                    {
+                        return true;
+                    }
+                }
+
+                if constexpr (is_work_stealing)
+                {
+                    while (steal(w, d, prio, hTask))
+                    {
+                        if (grab(hTask, prio))
+                        {
+                            return true;
+                        }
+                    }
+                }
+
+                return false;
+            };
+
+            // Order in which to check the priorities this time around
+            int32_t prios[PRIO_COUNT];
+            priorityScanOrder(w, prios);
+
+            const auto pumpTask = [this, &w, &grab, &pumpDomain, &prios](task_handle &hTask)
+            {
+                if (!running_.load())
+                {
+                    return true;
+                }
+
+                // Add the tasks of the timers that are due, if any
+                pollTimers();
+
+                // Tasks with a deadline first, the earliest one among the priorities we can take
+                while (true)
+                {
+                    auto earliestPrio       = -1;
+                    auto earliestDeadline   = deadline_queue<task_handle>::no_deadline;
+                    for (const auto prio : prios)
+                    {
+                        if (w.canWorkOnPriority(task_priority(prio)))
+                        {
+                            const auto deadline = deadlineTasks_[prio].nextDeadline();
+                            if (deadline < earliestDeadline)
+                            {
+                                earliestPrio        = prio;
+                                earliestDeadline    = deadline;
+                            }
+                        }
+                    }
+
+                    if (earliestPrio < 0 || !deadlineTasks_[earliestPrio].tryPop(hTask))
+                    {
+                        break;
+                    }
+                    if (grab(hTask, earliestPrio))
+                    {
+                        return true;
+                    }
+                }
+
+                // Then our own domain, and our mailbox along the way
+                const auto home = w.getNumaNode();
+                auto &box = *mailboxes_[w.getIndex()];
+                for (const auto prio : prios)
+                {
+                    if (box.pending.load() > 0)
+                    {
+                        while (box.tasks[prio].tryPop(hTask))
+                        {
+                            box.pending.fetch_sub(1);
+                            if (grab(hTask, prio))
+                            {
+                                return true;
+                            }
+                        }
+                    }
+
+                    if (w.canWorkOnPriority(task_priority(prio)))
+                    {
+                        if constexpr (is_work_stealing)
+                        {
+                            auto &localQueue = localQueues_[w.getIndex()]->tasks[prio];
+                            while (localQueue.tryPop(hTask))
+                            {
+                                if (grab(hTask, prio))
+                                {
+                                    return true;
+                                }
+                            }
+                        }
+
+                        if (pumpDomain(home, prio, hTask))
+                        {
+                            return true;
+                        }
+                    }
+                }
+
+                // Then the other domains, as a last resort
+                const auto domainCount = int32_t(domains_.size());
+                for (auto i = 1; i < domainCount; ++i)
+                {
+                    const auto node = (home + i) % domainCount;
+                    for (const auto prio : prios)
+                    {
+                        if (w.canWorkOnPriority(task_priority(prio)) && pumpDomain(node, prio, hTask))
+                        {
+                            return true;
+                        }
+                    }
+                }
+
+                return false;
+            };
+
+            // Before checking if we have a task discard the pending notifications
+            w.resetNotifications();
+
+            task_handle hTask;
+            auto phase = idle_phase::busy;
+            auto found = pumpTask(hTask);
+
+            // Nothing to do, apply the idle policy of the worker: spin, yield, then sleep
+            if (!found && canIdle)
+            {
+                phase = idle_phase::spin;
+                for (auto i = w.getSpinBudget(); i > 0 && !found; --i)
+                {
+                    this_thread::pause();
+                    found = pumpTask(hTask);
+                }
+            }
+
+            if (!found && canIdle)
+            {
+                phase = idle_phase::yield;
+                for (auto i = w.getConfig().idlePolicy.yieldCount; i > 0 && !found; --i)
+                {
+                    this_thread::yield();
+                    found = pumpTask(hTask);
+                }
+            }
+
+            if (!found && canIdle)
+            {
+                phase = idle_phase::park;
+                do
+                {
+                    // Tell the producers that we're going to sleep, then check one last time in case a
+                    // task was added before they could see us
+                    auto &idleWorkers = domains_[w.getNumaNode()]->idleWorkers;
+                    idleWorkers.setIdle(w);
+                    if (pumpTask(hTask))
+                    {
+                        if (!idleWorkers.clearIdle(w))
+                        {
+                            // Someone claimed us in the meantime, their task might still be pending
+                            forwardWakeUp(w);
+                        }
+                        break;
+                    }
+
+                    const auto notified = waitForNotification(w);
+                    const auto claimed  = !idleWorkers.clearIdle(w);
+                    if (!notified && !claimed && tryRetire(w))
+                    {
+                        // Nobody needed us for a while, the thread stops
+                        return task_handle();
+                    }
+                    w.resetNotifications();
+                } while (!pumpTask(hTask));
+            }
+
+            if (hTask.isValid())
+            {
+                w.onTaskFound(phase);
+            }
+
+            return hTask;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Called by worker threads when they are available, this function blocks on the worker's
+        // notifier. Once it's notified it proceeds to getting a valid task from the queue.
+        // Returns false if the worker has been retired instead, its thread has to stop.
+        bool signalAvailableWorker(worker_base &w)
+        {
+            // Remember which worker runs on this thread so that tasks added from here can be
+            // pushed to its local queue
+            this_worker() = current_worker{ this, w.getIndex() };
+
+            // Loop until we find a task to work on
+            while (true)
+            {
+                // Grab the next task
+                task_handle hTask = waitForNextTask(w);
+
+                // We could have been waken up to stop
+                if (!running_.load())
+                {
+                    if (hTask.isValid())
+                    {
+                        releaseInFlight();
+                    }
+                    return true;
+                }
+
+                // Only retired workers leave empty handed, see tryRetire
+                if (!hTask.isValid())
+                {
+                    return false;
+                }
+
+                // Make sure it's runnable
+                if (oqpi_ensure(hTask.isValid() && hTask.isGrabbed()))
+                {
+                    // Make sure it's not done (activeWait on groups can leave a task done without being grabbed)
+                    if (!hTask.isDone())
+                    {
+                        // Assign it to the available worker
+                        w.assign(std::move(hTask));
+
+                        // We got a task! See ya!
+                        return true;
+                    }
+                    releaseInFlight();
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by worker threads waiting for a task to be done, returns a task to run in the
+        // meantime or an invalid handle if there's none. Never blocks.
+        task_handle signalHelpingWorker(worker_base &w)
+        {
+            return waitForNextTask(w, false);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by worker threads waiting for a task to be done once they found nothing to run
+        // for a while. Puts the worker to sleep until the awaited task is done or tasks are added,
+        // returns a task to run if there's one. The awaited task notifies the worker once it's
+        // done, see wait_helper::notifyWhenDone.
+        task_handle parkHelpingWorker(worker_base &w, task_base &awaited)
+        {
+            // Same as parking in waitForNextTask: visible to the producers first, then a last
+            // check for what was added or finished before they could see us
+            auto &idleWorkers = domains_[w.getNumaNode()]->idleWorkers;
+            idleWorkers.setIdle(w);
+            auto hTask = waitForNextTask(w, false);
+            if (!hTask.isValid() && !awaited.isDone() && running_.load())
+            {
+                waitForNotification(w);
+            }
+            if (!idleWorkers.clearIdle(w) && hTask.isValid())
+            {
+                // Someone claimed us in the meantime, their task might still be pending
+                forwardWakeUp(w);
+            }
+            return hTask;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by worker threads to execute a task they grabbed, on a fiber if the task asks for
+        // one. A task suspended on its fiber returns early, without being done.
+        void executeTask(task_handle &hTask)
+        {
+            if (hTask.getFiber() != nullptr || resolveTaskFiber(hTask))
+            {
+                executeOnFiber(hTask);
+            }
+            else
+            {
+                hTask.execute();
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the calling thread is one of our workers and could have popped the task from
+        // the queues itself: the task is not pinned to another worker nor to cores the worker is
+        // not restricted to, the worker works on its priority, and it doesn't run on a fiber.
+        // Such a task can be run right away, see runInline.
+        bool canRunInline(task_handle &hTask)
+        {
+            const auto workerIndex = currentWorkerIndex();
+            if (workerIndex < 0 || !hTask.isValid() || resolveTaskFiber(hTask))
+            {
+                return false;
+            }
+
+            const auto &w = *workers_[workerIndex];
+            const auto pinnedTo = hTask.getWorkerAffinity();
+            if (pinnedTo >= 0)
+            {
+                // Mailboxes are pumped no matter the priority
+                return pinnedTo == workerIndex;
+            }
+
+            const auto cores = uint32_t(hTask.getCoreAffinity());
+            if (cores != uint32_t(core_affinity::all_cores))
+            {
+                return (uint32_t(w.getConfig().threadAttributes.coreAffinityMask_) & ~cores) == 0;
+            }
+
+            return w.canWorkOnPriority(resolveTaskPriority(hTask));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runs a task the calling worker could have popped (see canRunInline) on that worker, the
+        // same way as a task coming from the queues: the worker context is called, the deadline
+        // is checked and the task counts as in flight. Does nothing if the task has already been
+        // grabbed by someone else.
+        void runInline(task_handle &hTask)
+        {
+            const auto workerIndex = currentWorkerIndex();
+            oqpi_checkf(workerIndex >= 0, "Trying to run a task inline outside of a worker: %d", hTask.getUID());
+            if (workerIndex < 0 || !hTask.tryGrab())
+            {
+                return;
+            }
+
+            if (hTask.isCancelled())
+            {
+                // Discarded, see waitForNextTask
+                hTask.execute();
+                return;
+            }
+
+            // Released by the worker once it's done with it, like a popped task
+            inFlight_.count.fetch_add(1);
+            resolveTaskDeadline(hTask);
+            workers_[workerIndex]->runInline(hTask);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by worker threads once they're done executing a task, right before releasing it.
+        // Groups are usually not done at this point, their children are checked instead.
+        void signalTaskExecuted(const task_handle &hTask)
+        {
+            if (hTask.hasDeadline() && hTask.isDone())
+            {
+                checkDeadline(hTask);
+            }
+            releaseInFlight();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Puts the worker to sleep until notified. If timers are pending and nobody is keeping
+        // time, the worker becomes the timekeeper and only sleeps until the next timer expires.
+        // Returns false if an extra worker of an elastic pool slept for its whole retire time.
+        bool waitForNotification(worker_base &w)
+        {
+            auto expected = -1;
+            if (timers_.nextExpiry() != timer_wheel::no_expiry && timekeeper_.compare_exchange_strong(expected, w.getIndex()))
+            {
+                // Checked again once we're the timekeeper, addTimer checks who's the timekeeper
+                // after changing the next expiry
+                const auto timeoutNs = timers_.nextExpiry() - now_ns();
+                if (timeoutNs > 0)
+                {
+                    w.waitFor(timeoutNs);
+                }
+                timekeeper_.store(-1);
+            }
+            else if (slots_[w.getIndex()]->group >= 0)
+            {
+                return w.waitFor(w.getConfig().elastic.retireIdleTime.count());
+            }
+            else
+            {
+                w.wait();
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void addTimer(const std::shared_ptr<timer_entry> &spTimer, int64_t expiryNs, int64_t periodNs)
+        {
+            if (timers_.add(spTimer, expiryNs, periodNs))
+            {
+                // The timekeeper, if any, sleeps for too long now
+                const auto timekeeper = timekeeper_.load();
+                if (timekeeper >= 0)
+                {
+                    workers_[timekeeper]->notify();
+                }
+                else
+                {
+                    for (auto prio = 0; prio < PRIO_COUNT && wakeUpWorkers(0, task_priority(prio), 1) == 0; ++prio);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Expires the timers that are due and adds their tasks
+        void pollTimers()
+        {
+            const auto nextExpiry = timers_.nextExpiry();
+            if (nextExpiry != timer_wheel::no_expiry)
+            {
+                const auto now = now_ns();
+                if (nextExpiry <= now)
+                {
+                    auto &tasks = this_thread_timer_tasks();
+                    timers_.advance(now, tasks);
+                    if (!tasks.empty())
+                    {
+                        addBatch(tasks.begin(), tasks.end());
+                        tasks.clear();
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        void addWorkersPerPrio(worker_priority workerPrio, int32_t count)
+        {
+            for (auto prio = 0; prio < PRIO_COUNT; ++prio)
+            {
+                if (can_work_on_priority(workerPrio, task_priority(prio)))
+                {
+                    workersPerPrio_[prio].fetch_add(count);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Starts one more worker of the elastic pools able to run tasks of this priority once its
+        // tasks wait for longer than the threshold, for at least as long
+        void checkWaitThreshold(int prio, const task_handle &hTask)
+        {
+            const auto now      = now_ns();
+            const auto waitNs   = now - hTask.getEnqueueTime();
+            for (auto &upGroup : elasticGroups_)
+            {
+                auto &group = *upGroup;
+                if (!can_work_on_priority(group.workerPrio, task_priority(prio)))
+                {
+                    continue;
+                }
+
+                if (waitNs <= group.spawnWaitThresholdNs)
+                {
+                    if (group.overThresholdSince.load(std::memory_order_relaxed) != 0)
+                    {
+                        group.overThresholdSince.store(0, std::memory_order_relaxed);
+                    }
+                    continue;
+                }
+
+                auto since = group.overThresholdSince.load(std::memory_order_relaxed);
+                if (since == 0)
+                {
+                    group.overThresholdSince.compare_exchange_strong(since, now, std::memory_order_relaxed);
+                }
+                else if (now - since >= group.spawnWaitThresholdNs && group.overThresholdSince.compare_exchange_strong(since, 0, std::memory_order_relaxed))
+                {
+                    lock_t __l(elasticMutex_);
+                    for (auto index = group.firstWorker; index < group.lastWorker; ++index)
+                    {
+                        if (restartWorker(index))
+                        {
+                            return;
+                        }
+                    }
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Starts the thread of a retired worker again, elasticMutex_ has to be locked.
+        // Returns false if the worker is not retired or the scheduler is stopping.
+        bool restartWorker(int32_t index)
+        {
+            auto &slot = *slots_[index];
+            if (!running_.load() || !slot.retired.load())
+            {
+                return false;
+            }
+
+            // The thread is done or about to be, it only has to leave the worker's loop
+            auto &w = *workers_[index];
+            w.join();
+            slot.retired.store(false);
+            addWorkersPerPrio(w.getPriority(), 1);
+            w.start();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by an extra worker of an elastic pool that slept for its whole retire time
+        // without being claimed. Returns true if it's retired, its thread has to stop then.
+        bool tryRetire(const worker_base &w)
+        {
+            const auto index = w.getIndex();
+            auto &slot = *slots_[index];
+            lock_t __l(elasticMutex_);
+            if (!running_.load() || activeCount(slot.group) <= w.getConfig().count)
+            {
+                return false;
+            }
+
+            // pushToMailbox pushes then checks the flag, we set it then check the mailbox: either
+            // we see the task or they see us retired and start us again
+            slot.retired.store(true);
+            if (mailboxes_[index]->pending.load() > 0)
+            {
+                slot.retired.store(false);
+                return false;
+            }
+
+            addWorkersPerPrio(w.getPriority(), -1);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of workers of an elastic group that are not retired
+        int32_t activeCount(int32_t groupIndex) const
+        {
+            const auto &group = *elasticGroups_[groupIndex];
+            auto count = 0;
+            for (auto index = group.firstWorker; index < group.lastWorker; ++index)
+            {
+                count += slots_[index]->retired.load() ? 0 : 1;
+            }
+            return count;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Counts the task and reports it if it finished after its deadline
+        void checkDeadline(const task_handle &hTask)
+        {
+            deadlineCounters_.count.fetch_add(1, std::memory_order_relaxed);
+
+            const auto latenessNs = now_ns() - hTask.getDeadline();
+            if (latenessNs > 0)
+            {
+                deadlineCounters_.missed.fetch_add(1, std::memory_order_relaxed);
+                auto maxNs = deadlineCounters_.maxLatenessNs.load(std::memory_order_relaxed);
+                while (uint64_t(latenessNs) > maxNs && !deadlineCounters_.maxLatenessNs.compare_exchange_weak(maxNs, uint64_t(latenessNs), std::memory_order_relaxed));
+
+                if (config_.onDeadlineMissed)
+                {
+                    config_.onDeadlineMissed(hTask.getUID(), latenessNs);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Signal all workers
+        void wakeUpAllWorkers()
+        {
+            for (auto &upWorker : workers_)
+            {
+                upWorker->notify();
+            }
+
+        }
+        //------------------------------------------------------------------------------------------
+        // Signal up to count sleeping workers of the specified priority, the ones of the specified
+        // domain first. Returns how many were actually signaled.
+        int32_t wakeUpWorkers(int32_t node, task_priority prio, int32_t count)
+        {
+            const auto notify = [this](int32_t index)
+            {
+                workers_[index]->notify();
+            };
+
+            const auto domainCount = int32_t(domains_.size());
+            auto woken = 0;
+            for (auto i = 0; i < domainCount && woken < count; ++i)
+            {
+                woken += domains_[(node + i) % domainCount]->idleWorkers.wakeUp(prio, count - woken, notify);
+            }
+            return woken;
+        }
+        //------------------------------------------------------------------------------------------
+        // Hand a notification we did not use over to another sleeping worker
+        void forwardWakeUp(const worker_base &w)
+        {
+            for (auto prio = 0; prio < PRIO_COUNT && running_.load(); ++prio)
+            {
+                if (w.canWorkOnPriority(task_priority(prio)) && hasPendingTasks(prio))
+                {
+                    wakeUpWorkers(w.getNumaNode(), task_priority(prio), 1);
+                    return;
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        using lock_t = std::lock_guard<std::mutex>;
+
+        //------------------------------------------------------------------------------------------
+        // Queues owned by a worker when work stealing is enabled
+        struct local_queues
+        {
+            explicit local_queues(int32_t index)
+                : seed(uint32_t(index) * 2654435761u + 1u)
+            {}
+
+            // xorshift, used to pick the first victim to steal from
+            uint32_t nextRandom()
+            {
+                seed ^= seed << 13;
+                seed ^= seed >> 17;
+                seed ^= seed << 5;
+                return seed;
+            }
+
+            _LocalQueueType<task_handle>    tasks[PRIO_COUNT];
+            uint32_t                        seed;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Workers of a config registered with an elastic_policy
+        struct elastic_group
+        {
+            elastic_group(const worker_config &config, int32_t first)
+                : workerPrio(config.workerPrio)
+                , firstWorker(first)
+                , lastWorker(first + config.maxCount())
+                , spawnWaitThresholdNs(config.elastic.spawnWaitThreshold.count())
+                , overThresholdSince(0)
+            {}
+
+            const worker_priority   workerPrio;
+            // Range of the workers in the scheduler's list
+            const int32_t           firstWorker;
+            const int32_t           lastWorker;
+            const int64_t           spawnWaitThresholdNs;
+            // Since when the tasks of the group wait for too long, 0 if they don't
+            std::atomic<int64_t>    overThresholdSince;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // State of a worker as far as elastic pools are concerned
+        struct worker_slot
+        {
+            worker_slot(int32_t g, bool r)
+                : group(g)
+                , retired(r)
+            {}
+
+            // Index in elasticGroups_, -1 if the worker is always running
+            const int32_t           group;
+            // The worker's thread is stopped, or about to
+            std::atomic<bool>       retired;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Tasks pinned to a worker, one queue per priority
+        struct mailbox
+        {
+            _TaskQueueType<task_handle>     tasks[PRIO_COUNT];
+            // Number of tasks in the queues, spares checking each of them when it's empty
+            std::atomic<int32_t>            pending = { 0 };
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Workers of a NUMA node and the queues they share
+        struct domain
+        {
+            _TaskQueueType<task_handle>     tasks[PRIO_COUNT];
+            // Workers sleeping or about to, per priority
+            idle_workers                    idleWorkers;
+            // Indices of the workers of this domain
+            std::vector<int32_t>            workers;
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Per thread buffers used to sort the tasks of a batch per domain and priority
+        static std::vector<std::vector<task_handle>>& this_thread_batch()
+        {
+            static thread_local std::vector<std::vector<task_handle>> batch;
+            return batch;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Per thread buffer of the tasks of the expired timers
+        static std::vector<task_handle>& this_thread_timer_tasks()
+        {
+            static thread_local std::vector<task_handle> tasks;
+            return tasks;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Wait time counters of a priority, on their own cache line
+        struct alignas(OQPI_CACHE_LINE_SIZE) wait_counters
+        {
+            std::atomic<uint64_t>           count   = { 0 };
+            std::atomic<uint64_t>           totalNs = { 0 };
+            std::atomic<uint64_t>           maxNs   = { 0 };
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Tasks queued or running, on its own cache line as every task touches it twice
+        struct alignas(OQPI_CACHE_LINE_SIZE) in_flight_counter
+        {
+            std::atomic<int64_t>            count   = { 0 };
+        };
+
+        //------------------------------------------------------------------------------------------
+        // Outcome of the tasks having a deadline, updated by the workers
+        struct alignas(OQPI_CACHE_LINE_SIZE) deadline_counters
+        {
+            std::atomic<uint64_t>           count           = { 0 };
+            std::atomic<uint64_t>           missed          = { 0 };
+            std::atomic<uint64_t>           maxLatenessNs   = { 0 };
+        };
+
+    private:
+        scheduler_config            config_;
+        // Start priorities of the weighted policy, empty with the strict policy
+        std::vector<int32_t>        priorityOrder_;
+        wait_counters               waitCounters_[PRIO_COUNT];
+        // Tasks having a deadline, one queue per priority shared by every domain
+        deadline_queue<task_handle> deadlineTasks_[PRIO_COUNT];
+        deadline_counters           deadlineCounters_;
+        // See waitIdle
+        in_flight_counter           inFlight_;
+        std::atomic<int32_t>        idleWaiters_;
+        std::mutex                  idleMutex_;
+        std::condition_variable     idleCondition_;
+        // Delayed and periodic tasks
+        timer_wheel                 timers_;
+        // Index of the worker sleeping until the next timer expires, -1 if none
+        std::atomic<int32_t>        timekeeper_;
+        std::vector<worker_uptr>    workers_;
+        // Workers running per priority, retired ones are not counted
+        std::atomic<int32_t>        workersPerPrio_[PRIO_COUNT];
+        std::atomic<bool>           running_;
+        // One entry per NUMA node
+        std::vector<std::unique_ptr<domain>>        domains_;
+        // One entry per worker, empty if work stealing is disabled
+        std::vector<std::unique_ptr<local_queues>>  localQueues_;
+        // One entry per worker
+        std::vector<std::unique_ptr<mailbox>>       mailboxes_;
+        std::vector<std::unique_ptr<worker_slot>>   slots_;
+        // See elastic_policy, workers are only started and retired with the mutex locked
+        std::vector<std::unique_ptr<elastic_group>> elasticGroups_;
+        std::mutex                                  elasticMutex_;
+        // Used to spread the tasks pinned to a core set
+        std::atomic<uint32_t>                       nextPinnedWorker_ = { 0 };
+        // Fibers of the tasks running on one, see task_base::setRunOnFiber
+        fiber_pool                                  fibers_;
     };
     //----------------------------------------------------------------------------------------------
 
+
+    //----------------------------------------------------------------------------------------------
+    // Scheduler where each worker owns a Chase-Lev deque per priority
+    template<template<typename> class _TaskQueueType>
+    using work_stealing_scheduler = scheduler<_TaskQueueType, work_stealing_deque>;
+    //----------------------------------------------------------------------------------------------
+
  } /*oqpi*/
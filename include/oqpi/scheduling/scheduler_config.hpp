@@ -0,0 +1,88 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <functional>
+
+#include "oqpi/scheduling/task_type.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // How workers pick the priority to take their next task from
+    enum class priority_policy
+    {
+        // Always the highest non empty priority, lower priorities can starve under load
+        strict,
+        // Each priority gets a guaranteed share of the dequeues of each worker, proportional to
+        // its weight. A worker starts its search at a priority picked in a weighted round robin
+        // fashion and falls back to the strict order when that priority is empty, so the weights
+        // only matter when several priorities have pending tasks.
+        weighted,
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Options of a scheduler, to be set before starting it
+    struct scheduler_config
+    {
+        scheduler_config()
+            : priorityPolicy(priority_policy::strict)
+            , priorityWeights{ 16, 8, 4, 2, 1 }
+            , trackWaitTimes(false)
+            , onDeadlineMissed(nullptr)
+            , timerResolution(std::chrono::milliseconds(1))
+            , fiberStackSize(256 * 1024)
+        {}
+
+        priority_policy priorityPolicy;
+        // Relative share of each priority with the weighted policy, has to be at least 1
+        int32_t         priorityWeights[int(task_priority::count)];
+        // Measure the time tasks spend in the queues, see priority_wait_stats
+        bool            trackWaitTimes;
+        // Called from the worker thread when a task finishes after its deadline, with the uid of
+        // the task and how late it is in nanoseconds. Missed deadlines are counted either way,
+        // see deadline_stats.
+        std::function<void(task_uid, int64_t)> onDeadlineMissed;
+        // Granularity of the delayed and periodic tasks, see timer_wheel
+        std::chrono::nanoseconds timerResolution;
+        // Stack size of the fibers of the tasks running on one, see task_base::setRunOnFiber
+        size_t          fiberStackSize;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Time spent in the queues by the tasks of a priority, between the moment they're added and
+    // the moment a worker grabs them
+    struct priority_wait_stats
+    {
+        // Number of tasks grabbed
+        uint64_t count;
+        // Accumulated and worst wait time
+        uint64_t totalNs;
+        uint64_t maxNs;
+
+        uint64_t averageNs() const
+        {
+            return count > 0 ? totalNs / count : 0;
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Outcome of the tasks having a deadline, measured when a worker finishes executing them
+    struct deadline_stats
+    {
+        // Number of tasks with a deadline executed by the workers
+        uint64_t count;
+        // How many of them finished after their deadline, and by how much at worst
+        uint64_t missed;
+        uint64_t maxLatenessNs;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
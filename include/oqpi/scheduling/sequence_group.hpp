@@ -1,6 +1,7 @@
 #pragma once
 
-#include <queue>
+#include <vector>
+#include <atomic>
 
 #include "oqpi/scheduling/task_group.hpp"
 
@@ -23,8 +24,9 @@ namespace oqpi {
     {
     public:
         //------------------------------------------------------------------------------------------
-        sequence_group(_Scheduler &sc, const std::string &name, task_priority priority)
+        sequence_group(_Scheduler &sc, const task_name &name, task_priority priority)
             : task_group<_Scheduler, _TaskType, _GroupContext>(sc, name, priority)
+            , currentTaskIndex_(0)
         {}
 
     public:
@@ -40,39 +42,66 @@ namespace oqpi {
         {
             if (task_base::tryGrab())
             {
-                while (!empty())
+                while (currentTaskIndex_.load() < tasks_.size())
                 {
-                    auto hTask = popTask();
-                    hTask.executeSingleThreaded();
+                    popTask().executeSingleThreaded();
                 }
+                tasks_.clear();
             }
         }
 
 
     protected:
         //------------------------------------------------------------------------------------------
-        virtual void addTaskImpl(const task_handle &hTask) override final
+        virtual void addTaskImpl(task_handle &&hTask) override final
         {
-            tasks_.push(hTask);
+            tasks_.emplace_back(std::move(hTask));
         }
 
         //------------------------------------------------------------------------------------------
         // Executes the current task
         virtual void executeImpl() override final
         {
-            auto hTask = popTask();
-            if (hTask.tryGrab())
+            auto &hTask = popTask();
+            if (hTask.isValid() && hTask.tryGrab())
             {
                 hTask.execute();
             }
         }
 
         //------------------------------------------------------------------------------------------
-        virtual void oneTaskDone() override final
+        virtual void rearmImpl() override final
         {
-            if (!empty())
+            for (auto &hTask : tasks_)
             {
-                this->scheduler_.add(popTask());
+                hTask.rearmInGroup(this);
+            }
+            currentTaskIndex_.store(0);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The task of the sequence currently scheduled
+        virtual bool runPendingChild() override final
+        {
+            const auto index = currentTaskIndex_.load();
+            if (index > 0 && index <= tasks_.size())
+            {
+                auto &hTask = tasks_[index - 1];
+                if (!hTask.isGrabbed() && hTask.tryGrab())
+                {
+                    hTask.execute();
+                    return true;
+                }
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void oneTaskDone(const task_base &) override final
+        {
+            if (currentTaskIndex_.load() < tasks_.size())
+            {
+                this->scheduler_.post(task_handle(popTask()));
             }
             else
             {
@@ -82,27 +111,32 @@ namespace oqpi {
 
     private:
         //------------------------------------------------------------------------------------------
-        task_handle popTask()
+        // Tasks are kept once run so that the sequence can be re-armed
+        task_handle& popTask()
         {
-            task_handle hTask;
-            if (oqpi_ensuref(!empty(), "Attempting to execute an empty sequence: %d", this->getUID()))
+            static task_handle invalidHandle;
+            const auto index = currentTaskIndex_.load();
+            if (oqpi_ensuref(index < tasks_.size(), "Attempting to execute an empty sequence: %d", this->getUID()))
             {
-                hTask = tasks_.front();
-                tasks_.pop();
+                currentTaskIndex_.store(index + 1);
+                return tasks_[index];
             }
-            return hTask;
+            return invalidHandle;
         }
 
     private:
         // Tasks of the sequence
-        std::queue<task_handle> tasks_;
+        std::vector<task_handle>    tasks_;
+        // Index of the next task to run, only written by the thread running the sequence as it
+        // runs one task at a time, but read by the threads helping it, see runPendingChild
+        std::atomic<size_t>         currentTaskIndex_;
     };
     //----------------------------------------------------------------------------------------------
     
 
     //----------------------------------------------------------------------------------------------
     template<task_type _TaskType, typename _GroupContext, typename _Scheduler>
-    inline auto make_sequence_group(_Scheduler &sc, const std::string &name, task_priority prio)
+    inline auto make_sequence_group(_Scheduler &sc, const task_name &name, task_priority prio)
     {
         return make_task_group<sequence_group, _TaskType, _GroupContext>(sc, name, prio);
     }
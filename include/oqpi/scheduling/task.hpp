@@ -25,7 +25,7 @@ namespace oqpi {
 
     public:
         //------------------------------------------------------------------------------------------
-        task(const std::string &name, task_priority priority, _Func func)
+        task(const task_name &name, task_priority priority, _Func func)
             : task_base(priority)
             , _TaskContext(this, name)
             , notifier_type()
@@ -36,6 +36,7 @@ namespace oqpi {
         // Movable
         task(self_type &&other)
             : task_base(std::move(other))
+            , task_result_type(std::move(other))
             , _TaskContext(std::move(other))
             , notifier_type(std::move(other))
             , func_(std::move(other.func_))
@@ -47,6 +48,7 @@ namespace oqpi {
             if (this != &rhs)
             {
                 task_base::operator =(std::move(rhs));
+                task_result_type::operator =(std::move(rhs));
                 _TaskContext::operator =(std::move(rhs));
                 notifier_type::operator =(std::move(rhs));
                 func_ = std::move(rhs.func_);
@@ -82,8 +84,13 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
+        // Workers run other tasks until this one is done, see task_base::helpUntilDone
         virtual void wait() override final
         {
+            if constexpr (_TaskType == task_type::waitable)
+            {
+                task_base::helpUntilDone();
+            }
             notifier_type::wait();
         }
 
@@ -101,38 +108,73 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
-        virtual void onParentGroupSet() override final
+        virtual void rearm() override final
+        {
+            task_base::rearmBase();
+            task_result_type::resetResult();
+            notifier_type::reset();
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        virtual bool runPendingTask() override final
+        {
+            if (!task_base::isGrabbed() && task_base::tryGrab())
+            {
+                execute();
+                return true;
+            }
+            return false;
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        virtual void onParentGroupSet(const task_group_sptr &spParentGroup) override final
         {
-            _TaskContext::task_onAddedToGroup(this->spParentGroup_);
+            _TaskContext::task_onAddedToGroup(spParentGroup);
         }
 
         //------------------------------------------------------------------------------------------
-        return_type getResult() const
+        // Reference to the result stored in the task
+        decltype(auto) getResult() const
         {
             oqpi_checkf(task_base::isDone(), "Trying to get the result of an unfinished task: %d", task_base::getUID());
             return task_result_type::getResult();
         }
 
         //------------------------------------------------------------------------------------------
-        return_type waitForResult()
+        decltype(auto) waitForResult()
         {
             wait();
             return getResult();
         }
 
+        //------------------------------------------------------------------------------------------
+        // Moves the result out of the task, only once
+        return_type takeResult()
+        {
+            oqpi_checkf(task_base::isDone(), "Trying to take the result of an unfinished task: %d", task_base::getUID());
+            return task_result_type::takeResult();
+        }
+
     private:
         //------------------------------------------------------------------------------------------
         inline void invoke()
         {
             // Run the preExecute code of the context
             _TaskContext::task_onPreExecute();
-            // Run the task itself
-            task_result_type::run(func_);
+            // Run the task itself, unless it was cancelled in which case it's done without result
+            if (!task_base::isCancelled())
+            {
+                task_result_type::run(func_);
+            }
             // Flag the task as done
             task_base::setDone();
             // Run the postExecute code of the context
             _TaskContext::task_onPostExecute();
-            // Signal that the task is done
+            // Kick off whatever was waiting on this task
+            task_base::runContinuations();
+            // Signal that the task is done, last as waiters are then free to re-arm it
             notifier_type::notify();
         }
 
@@ -143,10 +185,13 @@ namespace oqpi {
 
 
     //----------------------------------------------------------------------------------------------
+    // Same as make_task but the task and its control block are allocated with alloc, see
+    // slab_allocator
+    //
     // Type     : user defined
     // Context  : user defined
-    template<task_type _TaskType, typename _EventType, typename _TaskContext, typename _Func, typename... _Args>
-    inline auto make_task(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+    template<task_type _TaskType, typename _EventType, typename _TaskContext, typename _Allocator, typename _Func, typename... _Args>
+    inline auto allocate_task(const _Allocator &alloc, const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
     {
         auto f = [func = std::forward<_Func>(func), args = std::make_tuple(std::forward<_Args>(args)...)] () mutable
         {
@@ -154,13 +199,22 @@ namespace oqpi {
         };
 
         using task_type = task<_TaskType, _EventType, _TaskContext, std::decay_t<decltype(f)>>;
-        return std::make_shared<task_type>
+        return std::allocate_shared<task_type>
         (
+            alloc,
             name,
             priority,
             std::move(f)
         );
     }
     //----------------------------------------------------------------------------------------------
+    // Type     : user defined
+    // Context  : user defined
+    template<task_type _TaskType, typename _EventType, typename _TaskContext, typename _Func, typename... _Args>
+    inline auto make_task(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
+    {
+        return allocate_task<_TaskType, _EventType, _TaskContext>(std::allocator<char>(), name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
+    }
+    //----------------------------------------------------------------------------------------------
 
 } /*oqpi*/
@@ -1,9 +1,18 @@
 #pragma once
 
 #include <atomic>
+#include <chrono>
 #include <memory>
 #include <string>
+#include <functional>
+#include <utility>
+#include <algorithm>
+#include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_name.hpp"
+#include "oqpi/scheduling/cancellation_token.hpp"
 #include "oqpi/scheduling/task_type.hpp"
+#include "oqpi/threading/this_thread.hpp"
+#include "oqpi/threading/thread_attributes.hpp"
 
 
 namespace oqpi {
@@ -21,6 +30,57 @@ namespace oqpi {
     //----------------------------------------------------------------------------------------------
 
 
+    //----------------------------------------------------------------------------------------------
+    // Implemented by the threads able to run other tasks while they wait for one to be done, the
+    // workers. Each worker installs itself for its own thread, see this_thread_wait_helper.
+    class wait_helper
+    {
+    public:
+        virtual ~wait_helper() = default;
+        // Runs one pending task on the calling thread, returns false if there was none
+        virtual bool helpOnce() = 0;
+        // Makes awaited wake the helper up once it's done, called once per wait before parking
+        virtual void notifyWhenDone(task_base &awaited) = 0;
+        // Sleeps until awaited is done or tasks are added, runs one of them if it finds some
+        virtual void park(task_base &awaited) = 0;
+    };
+    //----------------------------------------------------------------------------------------------
+    // Helper of the calling thread, nullptr if it can't help
+    inline wait_helper*& this_thread_wait_helper()
+    {
+        static thread_local wait_helper *pHelper = nullptr;
+        return pHelper;
+    }
+    //----------------------------------------------------------------------------------------------
+    // Number of waits the calling thread is currently helping in, nested one in another
+    inline int32_t& this_thread_help_depth()
+    {
+        static thread_local int32_t depth = 0;
+        return depth;
+    }
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Implemented by the fibers running tasks, see task_fiber. A task waiting from a fiber
+    // suspends it instead of blocking or helping, the thread moves on to other tasks.
+    class fiber_base
+    {
+    public:
+        virtual ~fiber_base() = default;
+        // Switches away from the fiber until awaited is done. Returns on any thread.
+        virtual void suspendUntilDone(task_base &awaited) = 0;
+    };
+    //----------------------------------------------------------------------------------------------
+    // Fiber running on the calling thread, nullptr if it's not running one
+    inline fiber_base*& this_thread_fiber()
+    {
+        static thread_local fiber_base *pFiber = nullptr;
+        return pFiber;
+    }
+    //----------------------------------------------------------------------------------------------
+
+
     //----------------------------------------------------------------------------------------------
     // Base class for all kind of tasks, unit tasks as well as groups
     class task_base
@@ -30,24 +90,53 @@ namespace oqpi {
         // Constructor
         task_base(task_priority priority)
             : uid_(uid_provider())
-            , spParentGroup_(nullptr)
+            , pParentGroup_(nullptr)
             , priority_(priority)
+            , preferredNode_(-1)
+            , enqueueTime_(0)
+            , deadline_(0)
+            , workerAffinity_(-1)
+            , coreAffinity_(core_affinity::all_cores)
+            , groupIndex_(-1)
+            , runOnFiber_(false)
+            , pFiber_(nullptr)
             , grabbed_(false)
+            , resumable_(false)
             , done_(false)
+            , continuations_(nullptr)
         {}
 
         //------------------------------------------------------------------------------------------
         // Used as a base class for the whole task hierarchy
-        virtual ~task_base() = default;
+        virtual ~task_base()
+        {
+            // Continuations of a task that never ran
+            auto pNode = continuations_.load();
+            if (pNode != closed_continuations())
+            {
+                delete_continuations(pNode);
+            }
+        }
 
         //------------------------------------------------------------------------------------------
         // Can be moved
         task_base(task_base &&other) noexcept
             : uid_(other.uid_)
-            , spParentGroup_(std::move(other.spParentGroup_))
+            , pParentGroup_(std::exchange(other.pParentGroup_, nullptr))
             , priority_(other.priority_)
+            , preferredNode_(other.preferredNode_)
+            , enqueueTime_(other.enqueueTime_)
+            , deadline_(other.deadline_)
+            , workerAffinity_(other.workerAffinity_)
+            , coreAffinity_(other.coreAffinity_)
+            , groupIndex_(other.groupIndex_)
+            , runOnFiber_(other.runOnFiber_)
+            , pFiber_(std::exchange(other.pFiber_, nullptr))
+            , cancellationToken_(std::move(other.cancellationToken_))
             , grabbed_(other.grabbed_.load())
+            , resumable_(other.resumable_.load())
             , done_(other.done_.load())
+            , continuations_(other.continuations_.exchange(nullptr))
         {}
 
         //------------------------------------------------------------------------------------------
@@ -56,10 +145,21 @@ namespace oqpi {
             if (this != &rhs)
             {
                 uid_            = rhs.uid_;
-                spParentGroup_  = std::move(rhs.spParentGroup_);
+                pParentGroup_   = std::exchange(rhs.pParentGroup_, nullptr);
                 priority_       = rhs.priority_;
+                preferredNode_  = rhs.preferredNode_;
+                enqueueTime_    = rhs.enqueueTime_;
+                deadline_       = rhs.deadline_;
+                workerAffinity_ = rhs.workerAffinity_;
+                coreAffinity_   = rhs.coreAffinity_;
+                groupIndex_     = rhs.groupIndex_;
+                runOnFiber_     = rhs.runOnFiber_;
+                pFiber_         = std::exchange(rhs.pFiber_, nullptr);
+                cancellationToken_ = std::move(rhs.cancellationToken_);
                 grabbed_        = rhs.grabbed_.load();
+                resumable_      = rhs.resumable_.load();
                 done_           = rhs.done_.load();
+                delete_continuations(continuations_.exchange(rhs.continuations_.exchange(nullptr)));
 
                 rhs.uid_        = invalid_task_uid;
             }
@@ -78,9 +178,13 @@ namespace oqpi {
         virtual void executeSingleThreaded()    = 0;
         virtual void wait()                     = 0;
         virtual void activeWait()               = 0;
+        // Puts a task that is done, and waited for, back in the state it was in before being
+        // scheduled so that it can be scheduled again. Groups re-arm their tasks as well.
+        // Nothing gets allocated.
+        virtual void rearm()                    = 0;
 
     protected:
-        virtual void onParentGroupSet()         = 0;
+        virtual void onParentGroupSet(const task_group_sptr &spParentGroup) = 0;
 
     public:
         //------------------------------------------------------------------------------------------
@@ -90,15 +194,17 @@ namespace oqpi {
             return uid_;
         }
 
+        // The group keeps itself alive until all of its tasks are done, so that the tasks don't
+        // have to hold a reference to it
         inline void setParentGroup(const task_group_sptr &spParentGroup)
         {
-            spParentGroup_ = spParentGroup;
-            onParentGroupSet();
+            pParentGroup_ = spParentGroup.get();
+            onParentGroupSet(spParentGroup);
         }
 
-        inline const task_group_sptr& getParentGroup() const
+        inline task_group_base* getParentGroup() const
         {
-            return spParentGroup_;
+            return pParentGroup_;
         }
 
         inline task_priority getPriority() const
@@ -106,6 +212,143 @@ namespace oqpi {
             return priority_;
         }
 
+        // NUMA node this task should preferably run on, -1 if the task has no preference in which
+        // case it takes the one of its parent group or the one of the thread adding it
+        inline int32_t getPreferredNode() const
+        {
+            return preferredNode_;
+        }
+
+        inline void setPreferredNode(int32_t node)
+        {
+            preferredNode_ = node;
+        }
+
+        // Time at which the task was added to the scheduler, only set if the scheduler tracks
+        // wait times
+        inline int64_t getEnqueueTime() const
+        {
+            return enqueueTime_;
+        }
+
+        inline void setEnqueueTime(int64_t time)
+        {
+            enqueueTime_ = time;
+        }
+
+        // Absolute deadline in nanoseconds on the steady clock, 0 if the task has none in which
+        // case it takes the one of its parent group. Tasks having a deadline are run earliest
+        // deadline first, before any task without deadline.
+        inline int64_t getDeadline() const
+        {
+            return deadline_;
+        }
+
+        inline void setDeadline(int64_t deadline)
+        {
+            deadline_ = deadline;
+        }
+
+        inline void setDeadline(std::chrono::steady_clock::time_point deadline)
+        {
+            deadline_ = std::max<int64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(deadline.time_since_epoch()).count(), 1);
+        }
+
+        inline bool hasDeadline() const
+        {
+            return deadline_ > 0;
+        }
+
+        // Index of the only worker allowed to run this task, -1 for any worker.
+        // Unlike the other properties it's not inherited by the tasks of a group.
+        inline int32_t getWorkerAffinity() const
+        {
+            return workerAffinity_;
+        }
+
+        inline void setWorkerAffinity(int32_t workerIndex)
+        {
+            workerAffinity_ = workerIndex;
+        }
+
+        // Cores the worker running this task has to be restricted to (see
+        // thread_attributes::coreAffinityMask_), all_cores for any worker.
+        // Ignored if the task is pinned to a specific worker.
+        inline core_affinity getCoreAffinity() const
+        {
+            return coreAffinity_;
+        }
+
+        inline void setCoreAffinity(core_affinity coreAffinity)
+        {
+            coreAffinity_ = coreAffinity;
+        }
+
+        // Index of the task in its parent group, only set by the groups needing to know which of
+        // their tasks is done (see task_graph), -1 otherwise
+        inline int32_t getGroupIndex() const
+        {
+            return groupIndex_;
+        }
+
+        inline void setGroupIndex(int32_t index)
+        {
+            groupIndex_ = index;
+        }
+
+        // Whether the task runs on a fiber of the scheduler, in which case waiting for another
+        // task suspends it instead of blocking its worker. false by default, in which case it
+        // takes the one of its parent group.
+        inline bool getRunOnFiber() const
+        {
+            return runOnFiber_;
+        }
+
+        inline void setRunOnFiber(bool runOnFiber)
+        {
+            runOnFiber_ = runOnFiber;
+        }
+
+        // Fiber the task is running on, from the moment a worker starts it until it's done
+        inline fiber_base* getFiber() const
+        {
+            return pFiber_;
+        }
+
+        inline void setFiber(fiber_base *pFiber)
+        {
+            pFiber_ = pFiber;
+        }
+
+        // Token cancelling the task, see cancellation_token. Has to be set before the task is
+        // scheduled. The tasks of a group are cancelled along with it.
+        inline const cancellation_token& getCancellationToken() const
+        {
+            return cancellationToken_;
+        }
+
+        inline void setCancellationToken(cancellation_token token)
+        {
+            cancellationToken_ = std::move(token);
+        }
+
+        // Whether the token of the task or of one of its parent groups is cancelled. Only one
+        // atomic load per token found, none for tasks and groups without one.
+        inline bool isCancelled() const;
+
+        // A task suspended on its fiber is requeued once what it waits for is done. Being
+        // grabbed already, the worker popping it has to take the resume token instead.
+        inline void setResumable()
+        {
+            resumable_.store(true);
+        }
+
+        inline bool tryResume()
+        {
+            bool expected = true;
+            return resumable_.compare_exchange_strong(expected, false);
+        }
+
         inline bool tryGrab()
         {
             bool expected = false;
@@ -129,18 +372,192 @@ namespace oqpi {
 
         inline void notifyParent();
 
+        // Re-arms a task of a group, the link to the group being dropped once the task is done
+        inline void rearmInGroup(task_group_base *pParentGroup)
+        {
+            pParentGroup_ = pParentGroup;
+            rearm();
+        }
+
+        // Calls func once the task is done, from the thread finishing it, or right away from the
+        // calling thread if the task is already done. Returns false in the latter case.
+        // Continuations are called in the order they were added and never block anyone.
+        inline bool addContinuation(std::function<void()> func)
+        {
+            auto pNode  = new continuation_node{ std::move(func), continuations_.load() };
+            while (pNode->pNext != closed_continuations())
+            {
+                if (continuations_.compare_exchange_weak(pNode->pNext, pNode))
+                {
+                    return true;
+                }
+            }
+
+            pNode->func();
+            delete pNode;
+            return false;
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        // Runs one of the tasks this one is waiting for on the calling thread, returns false if
+        // none could be grabbed. Groups run their pending children.
+        virtual bool runPendingTask()
+        {
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // When called from a worker, runs pending tasks until this one is done instead of
+        // blocking: the awaited task or its children first, then anything the scheduler has.
+        // When there's nothing to run for a while the worker sleeps until this task is done or
+        // new tasks come. From a fiber, the fiber is suspended instead.
+        // Returns false if the calling thread can't help, the caller has to block in that case.
+        inline bool helpUntilDone()
+        {
+            if (const auto pFiber = this_thread_fiber())
+            {
+                pFiber->suspendUntilDone(*this);
+                return true;
+            }
+
+            const auto pHelper = this_thread_wait_helper();
+            if (pHelper == nullptr)
+            {
+                return false;
+            }
+
+            // Empty attempts before sleeping, the task is likely about to finish before that
+            constexpr auto yieldCount = 64;
+
+            ++this_thread_help_depth();
+            auto idleCount = 0;
+            auto watched   = false;
+            while (!isDone())
+            {
+                if (runPendingTask() || pHelper->helpOnce())
+                {
+                    idleCount = 0;
+                }
+                else if (++idleCount < yieldCount)
+                {
+                    this_thread::yield();
+                }
+                else
+                {
+                    // Only one wake up per wait, no matter how many times the helper parks
+                    if (!watched)
+                    {
+                        pHelper->notifyWhenDone(*this);
+                        watched = true;
+                    }
+                    pHelper->park(*this);
+                    idleCount = 0;
+                }
+            }
+            --this_thread_help_depth();
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Resets the flags of the task, see rearm
+        inline void rearmBase()
+        {
+            oqpi_checkf(isDone() || !isGrabbed(), "Trying to re-arm a running task: %d", uid_);
+            grabbed_.store(false);
+            done_.store(false);
+            // Continuations are only called once, the ones added since the task is done are kept
+            auto pClosed = closed_continuations();
+            continuations_.compare_exchange_strong(pClosed, nullptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Has to be called once the task is done, calls every continuation added so far and
+        // closes the list so that the ones added later are called right away
+        inline void runContinuations()
+        {
+            auto pNode = continuations_.exchange(closed_continuations());
+            if (pNode == closed_continuations())
+            {
+                return;
+            }
+
+            // The list is a stack, reverse it to call them in order
+            continuation_node *pOrdered = nullptr;
+            while (pNode)
+            {
+                auto pNext      = pNode->pNext;
+                pNode->pNext    = pOrdered;
+                pOrdered        = pNode;
+                pNode           = pNext;
+            }
+
+            while (pOrdered)
+            {
+                auto pNext = pOrdered->pNext;
+                pOrdered->func();
+                delete pOrdered;
+                pOrdered = pNext;
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct continuation_node
+        {
+            std::function<void()>   func;
+            continuation_node      *pNext;
+        };
+
+        // Marks the list of a task that is done
+        static continuation_node* closed_continuations()
+        {
+            static continuation_node closed{ nullptr, nullptr };
+            return &closed;
+        }
+
+        static void delete_continuations(continuation_node *pNode)
+        {
+            while (pNode && pNode != closed_continuations())
+            {
+                auto pNext = pNode->pNext;
+                delete pNode;
+                pNode = pNext;
+            }
+        }
+
     protected:
         //------------------------------------------------------------------------------------------
         // The unique id of this task
         task_uid            uid_;
         // Optional parent group
-        task_group_sptr     spParentGroup_;
+        task_group_base    *pParentGroup_;
         // Relative priority of the task
         task_priority       priority_;
+        // Preferred NUMA node, -1 for no preference
+        int32_t             preferredNode_;
+        // In nanoseconds, see scheduler_config::trackWaitTimes
+        int64_t             enqueueTime_;
+        // In nanoseconds on the steady clock, 0 for no deadline
+        int64_t             deadline_;
+        // Worker or cores this task is pinned to, if any
+        int32_t             workerAffinity_;
+        core_affinity       coreAffinity_;
+        // Index in the parent group, see getGroupIndex
+        int32_t             groupIndex_;
+        // See getRunOnFiber and getFiber
+        bool                runOnFiber_;
+        fiber_base         *pFiber_;
+        // See getCancellationToken
+        cancellation_token  cancellationToken_;
         // Token that has to be acquired by anyone before executing the task
         std::atomic<bool>   grabbed_;
+        // Token to acquire to resume a task suspended on its fiber
+        std::atomic<bool>   resumable_;
         // Flag flipped once the task execution is done
         std::atomic<bool>   done_;
+        // Functions to call once the task is done, see addContinuation
+        std::atomic<continuation_node*> continuations_;
 
     private:
         //------------------------------------------------------------------------------------------
@@ -16,7 +16,7 @@ namespace oqpi {
     class task_context_base
     {
     public:
-        task_context_base(task_base *pOwner, const std::string &)
+        task_context_base(task_base *pOwner, const task_name &)
             : pOwner_(pOwner)
         {}
 
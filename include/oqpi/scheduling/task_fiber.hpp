@@ -0,0 +1,178 @@
+#pragma once
+
+#include <mutex>
+#include <memory>
+#include <vector>
+#include <utility>
+
+#include "oqpi/threading/fiber.hpp"
+#include "oqpi/scheduling/task_handle.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Fiber running tasks, one at a time, on its own stack. A task waiting for another one from
+    // there switches back to the thread that started or resumed the fiber, which gets the task it
+    // waits for with run and arranges for the task to be resumed, possibly on another thread.
+    //
+    // The thread a task runs on can change each time it waits: thread local variables must not be
+    // kept across a wait by the tasks running on fibers.
+    //
+    class task_fiber final
+        : public fiber_base
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit task_fiber(size_t stackSize)
+            : context_(stackSize, &task_fiber::entry, this)
+            , pReturn_(nullptr)
+            , pAwaited_(nullptr)
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return context_.isValid();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Task to run the next time the fiber is switched to, it must be grabbed
+        void assign(const task_handle &hTask)
+        {
+            hTask_ = hTask;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void release()
+        {
+            hTask_.reset();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Starts or resumes the task on the calling thread until it's done, in which case nullptr
+        // is returned, or until it waits, in which case the task it waits for is returned. The
+        // caller is then off the fiber and has to arrange for it to be resumed.
+        task_base* run()
+        {
+            fiber_impl threadContext;
+            auto &pCurrent      = this_thread_fiber();
+            const auto pOuter   = pCurrent;
+            pCurrent            = this;
+            pReturn_            = &threadContext;
+
+            fiber_impl::switch_to(threadContext, context_);
+
+            // The thread stack never moves, its thread local variables are still its own
+            pCurrent = pOuter;
+            return std::exchange(pAwaited_, nullptr);
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void suspendUntilDone(task_base &awaited) override final
+        {
+            while (!awaited.isDone())
+            {
+                pAwaited_ = &awaited;
+                fiber_impl::switch_to(context_, *pReturn_);
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static void entry(void *pArg)
+        {
+            auto pThis = static_cast<task_fiber*>(pArg);
+            while (true)
+            {
+                pThis->hTask_.execute();
+                fiber_impl::switch_to(pThis->context_, *pThis->pReturn_);
+            }
+        }
+
+    private:
+        // Context of the fiber and of the thread it has to switch back to
+        fiber_impl  context_;
+        fiber_impl *pReturn_;
+        // Task running on the fiber
+        task_handle hTask_;
+        // Task the fiber waits for when it switches back, nullptr if its task is done
+        task_base  *pAwaited_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Fibers, with their stacks, are kept once their task is done to be reused by the next one.
+    // Fibers are only created when none is free, and only freed along with the pool.
+    //
+    class fiber_pool
+    {
+        using lock_t = std::lock_guard<std::mutex>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        fiber_pool()
+            : createdCount_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        fiber_pool(const fiber_pool &)              = delete;
+        fiber_pool& operator =(const fiber_pool &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Returns nullptr if a fiber could not be created
+        task_fiber* acquire(size_t stackSize)
+        {
+            {
+                lock_t __l(mutex_);
+                if (!freeFibers_.empty())
+                {
+                    auto pFiber = freeFibers_.back();
+                    freeFibers_.pop_back();
+                    return pFiber;
+                }
+            }
+
+            auto upFiber = std::make_unique<task_fiber>(stackSize);
+            if (!upFiber->isValid())
+            {
+                return nullptr;
+            }
+
+            auto pFiber = upFiber.get();
+            lock_t __l(mutex_);
+            fibers_.push_back(std::move(upFiber));
+            ++createdCount_;
+            return pFiber;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void release(task_fiber *pFiber)
+        {
+            pFiber->release();
+            lock_t __l(mutex_);
+            freeFibers_.push_back(pFiber);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of fibers created so far, which is the maximum number of tasks that have been
+        // running or suspended at once
+        size_t createdCount() const
+        {
+            lock_t __l(mutex_);
+            return createdCount_;
+        }
+
+    private:
+        mutable std::mutex                          mutex_;
+        std::vector<std::unique_ptr<task_fiber>>    fibers_;
+        std::vector<task_fiber*>                    freeFibers_;
+        size_t                                      createdCount_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <memory>
+#include <type_traits>
+
+#include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_handle.hpp"
+#include "oqpi/scheduling/task_result.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Typed handle on the result of a task, see helpers::schedule_future.
+    // The result lives in the task itself: get gives a reference to it, take moves it out, which
+    // can only be done once. Neither copies it, so move only results are fine.
+    // Like a task_handle, a future keeps its task alive and can be copied, the result is shared.
+    // Copies can all read it with get, or all compete to take it, but not both: taking the result
+    // from one copy destroys it under the references handed out by get on the others.
+    //
+    template<typename _ReturnType>
+    class task_future
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        // Constructs an invalid future
+        task_future()
+            : pResult_(nullptr)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Any task storing a result of this type, unit tasks and coroutine tasks
+        template<typename _Task, typename = std::enable_if_t<std::is_base_of<task_result<_ReturnType>, _Task>::value>>
+        task_future(std::shared_ptr<_Task> spTask)
+            : pResult_(spTask.get())
+            , hTask_(task_sptr(std::move(spTask)))
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return hTask_.isValid();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isDone() const
+        {
+            return hTask_.isDone();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The task was cancelled, it may still have run and have a result if it was cancelled late
+        bool isCancelled() const
+        {
+            return hTask_.isCancelled();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether get and take can be called without throwing: the task ran and its result was
+        // not taken. Always true for void results once the task is done.
+        bool hasResult() const
+        {
+            return isDone() && pResult_->hasResult();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Handle on the task, to add it to a group or a continuation for instance
+        const task_handle& getHandle() const
+        {
+            return hTask_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void wait() const
+        {
+            hTask_.wait();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Waits for the task and gives a reference to its result, valid as long as the future is
+        // and nobody takes the result, this future or any copy of it.
+        // Throws a no_result_error if there is none, see hasResult.
+        decltype(auto) get() const
+        {
+            wait();
+            if constexpr (std::is_void<_ReturnType>::value)
+            {
+                return;
+            }
+            else
+            {
+                return static_cast<const _ReturnType&>(pResult_->getResult());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Waits for the task and moves its result out. Whoever takes the result first is the only
+        // one to get it, the others get a no_result_error, even when taking it at the same time.
+        _ReturnType take()
+        {
+            wait();
+            return takeReady();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Same as take but the task has to be done already
+        _ReturnType takeReady()
+        {
+            oqpi_checkf(isDone(), "Trying to take the result of an unfinished task: %d", hTask_.getUID());
+            return pResult_->takeResult();
+        }
+
+    private:
+        task_result<_ReturnType>   *pResult_;
+        // Keeps the task, and the result it holds, alive
+        task_handle                 hTask_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
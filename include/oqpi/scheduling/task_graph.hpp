@@ -0,0 +1,323 @@
+#pragma once
+
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <utility>
+
+#include "oqpi/scheduling/task_group.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Builds an arbitrary directed acyclic graph of tasks:
+    //
+    //        +--[T1]--+
+    // [T0]--+          +--[T3]--[T4]
+    //        +--[T2]------------+
+    //
+    // Tasks are added as nodes, then edges are declared between them: a node only starts once
+    // all of its predecessors are done. Each node keeps an atomic count of the predecessors it
+    // still waits for, the node finishing last releases it.
+    // When a node is done, all of its successors that became ready but one are scheduled in one
+    // batch, and the last one runs right away on the same worker, provided that the worker could
+    // have taken it from the queues itself. Otherwise it's scheduled as well.
+    //
+    // This group is NOT thread safe! Meaning it does not allow multiple threads to concurrently
+    // add nodes or edges to it.
+    //
+    template<typename _Scheduler, task_type _TaskType, typename _GroupContext>
+    class task_graph final
+        : public task_group<_Scheduler, _TaskType, _GroupContext>
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using node_id = int32_t;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        task_graph(_Scheduler &sc, const task_name &name, task_priority priority, int32_t nodeCount = 0)
+            : task_group<_Scheduler, _TaskType, _GroupContext>(sc, name, priority)
+            , pendingNodesCount_(0)
+        {
+            tasks_.reserve(nodeCount);
+            successors_.reserve(nodeCount);
+            predecessorsCount_.reserve(nodeCount);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Adds a node and returns its id, -1 if the task could not be added
+        node_id addNode(task_handle hTask)
+        {
+            const auto id = node_id(tasks_.size());
+            this->addTask(std::move(hTask));
+            return node_id(tasks_.size()) > id ? id : -1;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Makes the node to wait for the node from
+        void addEdge(node_id from, node_id to)
+        {
+            const auto nodeCount = node_id(tasks_.size());
+            if (oqpi_ensuref(from >= 0 && from < nodeCount && to >= 0 && to < nodeCount && from != to, "Invalid edge: %d -> %d", from, to))
+            {
+                successors_[from].push_back(to);
+                ++predecessorsCount_[to];
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t nodesCount() const
+        {
+            return int32_t(tasks_.size());
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual bool empty() const override final
+        {
+            return tasks_.empty();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // For debug purposes, runs the nodes in a topological order
+        virtual void executeSingleThreadedImpl() override final
+        {
+            if (task_base::tryGrab())
+            {
+                const auto nodeCount = node_id(tasks_.size());
+                std::vector<int32_t> remaining(predecessorsCount_);
+                std::vector<node_id> ready;
+                for (auto i = 0; i < nodeCount; ++i)
+                {
+                    if (remaining[i] == 0)
+                    {
+                        ready.push_back(i);
+                    }
+                }
+
+                auto executed = 0;
+                while (!ready.empty())
+                {
+                    const auto i = ready.back();
+                    ready.pop_back();
+                    tasks_[i].executeSingleThreaded();
+                    ++executed;
+                    for (const auto successor : successors_[i])
+                    {
+                        if (--remaining[successor] == 0)
+                        {
+                            ready.push_back(successor);
+                        }
+                    }
+                }
+                oqpi_checkf(executed == nodeCount, "Cycle detected in the graph: %d", this->getUID());
+                tasks_.clear();
+                successors_.clear();
+                predecessorsCount_.clear();
+            }
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        virtual void addTaskImpl(task_handle &&hTask) override final
+        {
+            hTask.setGroupIndex(node_id(tasks_.size()));
+            tasks_.emplace_back(std::move(hTask));
+            successors_.emplace_back();
+            predecessorsCount_.push_back(0);
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void executeImpl() override final
+        {
+            const auto nodeCount = node_id(tasks_.size());
+            if (oqpi_ensuref(nodeCount > 0, "Trying to execute an empty graph"))
+            {
+                // Arm the counters
+                if (remaining_.size() != size_t(nodeCount))
+                {
+                    remaining_ = std::vector<std::atomic<int32_t>>(size_t(nodeCount));
+                }
+                for (auto i = 0; i < nodeCount; ++i)
+                {
+                    remaining_[i].store(predecessorsCount_[i], std::memory_order_relaxed);
+                }
+                pendingNodesCount_.store(nodeCount);
+
+                // Then start the roots
+                auto &ready = this_thread_ready();
+                for (auto i = 0; i < nodeCount; ++i)
+                {
+                    if (predecessorsCount_[i] == 0)
+                    {
+                        ready.emplace_back(tasks_[i]);
+                    }
+                }
+                oqpi_checkf(!ready.empty(), "No root in the graph, there's a cycle: %d", this->getUID());
+
+                run_inline(release(ready));
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Counters are armed when the graph is executed
+        virtual void rearmImpl() override final
+        {
+            for (auto &hTask : tasks_)
+            {
+                hTask.rearmInGroup(this);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // The nodes that are ready are in the queues already, the scheduler hands them out
+        virtual bool runPendingChild() override final
+        {
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void oneTaskDone(const task_base &task) override final
+        {
+            const auto index = task.getGroupIndex();
+            if (!oqpi_ensuref(index >= 0 && index < node_id(tasks_.size()), "Unknown node: %d", index))
+            {
+                return;
+            }
+
+            auto &ready = this_thread_ready();
+            for (const auto successor : successors_[index])
+            {
+                if (remaining_[successor].fetch_sub(1, std::memory_order_acq_rel) == 1)
+                {
+                    ready.emplace_back(tasks_[successor]);
+                }
+            }
+            auto hInline = release(ready);
+
+            if (pendingNodesCount_.fetch_sub(1) == 1)
+            {
+                this->notifyGroupDone();
+            }
+
+            run_inline(std::move(hInline));
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Schedules the ready tasks but the last one, which is returned to be run inline
+        task_handle release(std::vector<task_handle> &ready)
+        {
+            task_handle hInline;
+            if (!ready.empty())
+            {
+                hInline = std::move(ready.back());
+                ready.pop_back();
+                if (!ready.empty())
+                {
+                    this->scheduler_.addBatch(ready.begin(), ready.end());
+                }
+                ready.clear();
+            }
+            return hInline;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runs a task on the calling worker, through the same path as a task it popped, see
+        // scheduler::runInline. As the task can release its successors from there, and run one
+        // of them inline in turn, only the outermost call actually runs the tasks so that long
+        // chains don't grow the stack.
+        // A task waiting for something makes its thread run other tasks, see
+        // task_base::helpUntilDone. The outer loop is stuck until the wait is over, so each help
+        // depth has its own outermost call.
+        // Tasks finishing on a fiber schedule their successor instead, as do the tasks the worker
+        // could not have popped: pinned elsewhere, of a priority it doesn't work on, or running on
+        // a fiber.
+        void run_inline(task_handle &&hTask)
+        {
+            if (!hTask.isValid())
+            {
+                return;
+            }
+
+            // A fiber can be resumed on another thread, it must not hold on to this one's state
+            if (this_thread_fiber() != nullptr || !this->scheduler_.canRunInline(hTask))
+            {
+                this->scheduler_.post(std::move(hTask));
+                return;
+            }
+
+            auto &inlineTask = this_thread_inline_task();
+            const auto depth = this_thread_help_depth();
+            if (inlineTask.running && inlineTask.depth == depth)
+            {
+                if (inlineTask.hNext.isValid())
+                {
+                    // Someone else already queued a task to run inline, let a worker take this one
+                    this->scheduler_.post(std::move(hTask));
+                }
+                else
+                {
+                    inlineTask.hNext = std::move(hTask);
+                }
+                return;
+            }
+
+            auto outerTask = std::exchange(inlineTask, inline_task{ std::move(hTask), true, depth });
+            while (inlineTask.hNext.isValid())
+            {
+                auto hNext = std::move(inlineTask.hNext);
+                inlineTask.hNext.reset();
+                this->scheduler_.runInline(hNext);
+            }
+            inlineTask = std::move(outerTask);
+        }
+
+        //------------------------------------------------------------------------------------------
+        struct inline_task
+        {
+            task_handle hNext;
+            bool        running = false;
+            // Help depth of the outermost call, see run_inline
+            int32_t     depth   = 0;
+        };
+        static inline_task& this_thread_inline_task()
+        {
+            static thread_local inline_task inlineTask;
+            return inlineTask;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Per thread buffer of the tasks released at once
+        static std::vector<task_handle>& this_thread_ready()
+        {
+            static thread_local std::vector<task_handle> ready;
+            return ready;
+        }
+
+    private:
+        // Tasks of the nodes
+        std::vector<task_handle>                    tasks_;
+        // Nodes waiting for each node
+        std::vector<std::vector<node_id>>           successors_;
+        // Number of nodes each node waits for
+        std::vector<int32_t>                        predecessorsCount_;
+        // Number of predecessors each node still waits for, armed when the graph is executed
+        std::vector<std::atomic<int32_t>>           remaining_;
+        // Number of nodes not done yet
+        std::atomic<int32_t>                        pendingNodesCount_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    template<task_type _TaskType, typename _GroupContext, typename _Scheduler>
+    inline auto make_task_graph(_Scheduler &sc, const task_name &name, task_priority prio, int32_t nodeCount = 0)
+    {
+        return make_task_group<task_graph, _TaskType, _GroupContext>(sc, name, prio, nodeCount);
+    }
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
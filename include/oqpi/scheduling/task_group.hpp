@@ -20,7 +20,7 @@ namespace oqpi {
 
     public:
         //------------------------------------------------------------------------------------------
-        task_group(_Scheduler &sc, const std::string &name, task_priority priority)
+        task_group(_Scheduler &sc, const task_name &name, task_priority priority)
             : task_group_base(priority)
             , _GroupContext(this, name)
             , notifier_type()
@@ -40,9 +40,13 @@ namespace oqpi {
                 if (oqpi_ensuref(hTask.getParentGroup() == nullptr,
                     "This task (%d) is already bound to a group: %d", hTask.getUID(), hTask.getParentGroup()->getUID()))
                 {
-                    hTask.setParentGroup(shared_from_this());
-                    addTaskImpl(hTask);
+                    if (!spSelf_)
+                    {
+                        spSelf_ = shared_from_this();
+                    }
+                    hTask.setParentGroup(spSelf_);
                     _GroupContext::group_onTaskAdded(hTask);
+                    addTaskImpl(std::move(hTask));
                 }
             }
         }
@@ -62,58 +66,114 @@ namespace oqpi {
             _GroupContext::group_onPostExecute();
 
             task_base::setDone();
+            task_base::runContinuations();
             notifier_type::notify();
+            // The tasks have been released, the caller holds a reference to the group
+            spSelf_.reset();
         }
 
         //------------------------------------------------------------------------------------------
+        // Workers run other tasks until the group is done, see task_base::helpUntilDone
         virtual void wait() override final
         {
+            if constexpr (_TaskType == task_type::waitable)
+            {
+                task_base::helpUntilDone();
+            }
             notifier_type::wait();
         }
 
         //------------------------------------------------------------------------------------------
-        virtual void activeWait() override
+        // Runs the pending tasks of the group on the calling thread, then waits for the others
+        virtual void activeWait() override final
         {
-            oqpi_checkf(false, "Not supported, fall back to wait");
+            while (!task_base::isDone() && runPendingTask());
             wait();
         }
 
         //------------------------------------------------------------------------------------------
-        virtual void onParentGroupSet() override final
+        // The whole group is put back as it was before being scheduled: counters and tasks. Has to
+        // be called once the group has been waited for. Groups run with executeSingleThreaded
+        // release their tasks and can't be re-armed.
+        virtual void rearm() override final
+        {
+            task_base::rearmBase();
+            notifier_type::reset();
+            if (!this->empty())
+            {
+                spSelf_ = shared_from_this();
+            }
+            rearmImpl();
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void onParentGroupSet(const task_group_sptr &spParentGroup) override final
+        {
+            _GroupContext::group_onAddedToGroup(spParentGroup);
+        }
+
+    protected:
+        //------------------------------------------------------------------------------------------
+        // The group itself if it has not been picked up yet, one of its children otherwise
+        virtual bool runPendingTask() override final
         {
-            _GroupContext::group_onAddedToGroup(this->spParentGroup_);
+            if (!task_base::isGrabbed() && task_base::tryGrab())
+            {
+                execute();
+                return true;
+            }
+            return !task_base::isDone() && runPendingChild();
         }
 
     protected:
         //------------------------------------------------------------------------------------------
         // Implementation details interface
-        virtual void addTaskImpl(const task_handle &hTask)  = 0;
+        virtual void addTaskImpl(task_handle &&hTask)       = 0;
         virtual void executeImpl()                          = 0;
         virtual void executeSingleThreadedImpl()            = 0;
+        virtual void rearmImpl()                            = 0;
+        // Runs one of the children that are scheduled but not grabbed yet on the calling thread,
+        // returns false if there's none
+        virtual bool runPendingChild()                      = 0;
 
     protected:
         //------------------------------------------------------------------------------------------
-        // Called once all tasks of a group are done
+        // Called once all tasks of a group are done. The group can be destroyed when this returns,
+        // callers must not touch it afterwards.
         void notifyGroupDone()
         {
+            // Might be the last reference to the group, released once we're done with it
+            const auto spSelf = std::move(spSelf_);
             task_base::setDone();
             _GroupContext::group_onPostExecute();
+            task_base::runContinuations();
             notifier_type::notify();
             task_base::notifyParent();
         }
 
     protected:
         // We need a reference to the scheduler so that the groups can add their tasks
-        _Scheduler &scheduler_;
+        _Scheduler         &scheduler_;
+        // Reference the group holds on itself from the moment it has tasks until they're all done,
+        // the tasks only pointing to their group
+        task_group_sptr     spSelf_;
     };
     //----------------------------------------------------------------------------------------------
 
 
+    //----------------------------------------------------------------------------------------------
+    // Same as make_task_group but the group and its control block are allocated with alloc, see
+    // slab_allocator
+    template<template<typename, task_type, typename> class _TaskGroupType, task_type _TaskType, typename _GroupContext, typename _Allocator, typename _Scheduler, typename... _Args>
+    inline auto allocate_task_group(const _Allocator &alloc, _Scheduler &sc, const task_name &name, _Args &&...args)
+    {
+        return std::allocate_shared<_TaskGroupType<_Scheduler, _TaskType, _GroupContext>>(alloc, sc, name, std::forward<_Args>(args)...);
+    }
     //----------------------------------------------------------------------------------------------
     template<template<typename, task_type, typename> class _TaskGroupType, task_type _TaskType, typename _GroupContext, typename _Scheduler, typename... _Args>
-    inline auto make_task_group(_Scheduler &sc, const std::string &name, _Args &&...args)
+    inline auto make_task_group(_Scheduler &sc, const task_name &name, _Args &&...args)
     {
-        return std::make_shared<_TaskGroupType<_Scheduler, _TaskType, _GroupContext>>(sc, name, std::forward<_Args>(args)...);
+        return allocate_task_group<_TaskGroupType, _TaskType, _GroupContext>(std::allocator<char>(), sc, name, std::forward<_Args>(args)...);
     }
     //----------------------------------------------------------------------------------------------
 
@@ -30,7 +30,8 @@ namespace oqpi {
 
     public:
         virtual void addTask(task_handle hTask) = 0;
-        virtual void oneTaskDone()              = 0;
+        // Called by the tasks of the group once they're done
+        virtual void oneTaskDone(const task_base &task) = 0;
         virtual bool empty()        const       = 0;
     };
     //----------------------------------------------------------------------------------------------
@@ -41,12 +42,27 @@ namespace oqpi {
     // task_group_base.
     inline void task_base::notifyParent()
     {
-        if (spParentGroup_)
+        // Drop the link before notifying: once the group is done it can be re-armed, which links
+        // this task again. Groups done through activeWait can still be grabbed by a worker that
+        // looks at their parent, nothing is written if there's none.
+        if (auto pParentGroup = pParentGroup_)
         {
-            spParentGroup_->oneTaskDone();
-            spParentGroup_.reset();
+            pParentGroup_ = nullptr;
+            pParentGroup->oneTaskDone(*this);
         }
     }
     //----------------------------------------------------------------------------------------------
+    inline bool task_base::isCancelled() const
+    {
+        for (auto pTask = this; pTask != nullptr; pTask = pTask->pParentGroup_)
+        {
+            if (pTask->cancellationToken_.isCancelled())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    //----------------------------------------------------------------------------------------------
 
 } /*oqpi*/
@@ -110,6 +110,13 @@ namespace oqpi {
             return spTask_->isDone();
         }
 
+        //------------------------------------------------------------------------------------------
+        void rearm()
+        {
+            validate();
+            spTask_->rearm();
+        }
+
         //------------------------------------------------------------------------------------------
         bool tryGrab()
         {
@@ -131,6 +138,191 @@ namespace oqpi {
             return spTask_->getPriority();
         }
 
+        //------------------------------------------------------------------------------------------
+        int32_t getPreferredNode() const
+        {
+            validate();
+            return spTask_->getPreferredNode();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Has to be set before the task is scheduled
+        void setPreferredNode(int32_t node)
+        {
+            validate();
+            spTask_->setPreferredNode(node);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t getEnqueueTime() const
+        {
+            validate();
+            return spTask_->getEnqueueTime();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setEnqueueTime(int64_t time)
+        {
+            validate();
+            spTask_->setEnqueueTime(time);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t getDeadline() const
+        {
+            validate();
+            return spTask_->getDeadline();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setDeadline(int64_t deadline)
+        {
+            validate();
+            spTask_->setDeadline(deadline);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setDeadline(std::chrono::steady_clock::time_point deadline)
+        {
+            validate();
+            spTask_->setDeadline(deadline);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool hasDeadline() const
+        {
+            validate();
+            return spTask_->hasDeadline();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Calls func once the task is done, see task_base::addContinuation
+        bool addContinuation(std::function<void()> func)
+        {
+            validate();
+            return spTask_->addContinuation(std::move(func));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Adds hNext to the scheduler once this task is done, without blocking anyone.
+        // Returns hNext so that calls can be chained.
+        template<typename _Scheduler>
+        task_handle then(_Scheduler &sc, task_handle hNext)
+        {
+            validate();
+            oqpi_check(hNext.isValid());
+            spTask_->addContinuation([&sc, hNext]
+            {
+                sc.add(hNext);
+            });
+            return hNext;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t getGroupIndex() const
+        {
+            validate();
+            return spTask_->getGroupIndex();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setGroupIndex(int32_t index)
+        {
+            validate();
+            spTask_->setGroupIndex(index);
+        }
+
+        //------------------------------------------------------------------------------------------
+        int32_t getWorkerAffinity() const
+        {
+            validate();
+            return spTask_->getWorkerAffinity();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setWorkerAffinity(int32_t workerIndex)
+        {
+            validate();
+            spTask_->setWorkerAffinity(workerIndex);
+        }
+
+        //------------------------------------------------------------------------------------------
+        core_affinity getCoreAffinity() const
+        {
+            validate();
+            return spTask_->getCoreAffinity();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setCoreAffinity(core_affinity coreAffinity)
+        {
+            validate();
+            spTask_->setCoreAffinity(coreAffinity);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool getRunOnFiber() const
+        {
+            validate();
+            return spTask_->getRunOnFiber();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setRunOnFiber(bool runOnFiber)
+        {
+            validate();
+            spTask_->setRunOnFiber(runOnFiber);
+        }
+
+        //------------------------------------------------------------------------------------------
+        const cancellation_token& getCancellationToken() const
+        {
+            validate();
+            return spTask_->getCancellationToken();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setCancellationToken(cancellation_token token)
+        {
+            validate();
+            spTask_->setCancellationToken(std::move(token));
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isCancelled() const
+        {
+            validate();
+            return spTask_->isCancelled();
+        }
+
+        //------------------------------------------------------------------------------------------
+        fiber_base* getFiber() const
+        {
+            validate();
+            return spTask_->getFiber();
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setFiber(fiber_base *pFiber)
+        {
+            validate();
+            spTask_->setFiber(pFiber);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void setResumable()
+        {
+            validate();
+            spTask_->setResumable();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool tryResume()
+        {
+            validate();
+            return spTask_->tryResume();
+        }
+
         //------------------------------------------------------------------------------------------
         void setParentGroup(const task_group_sptr &spParentGroup)
         {
@@ -139,12 +331,19 @@ namespace oqpi {
         }
 
         //------------------------------------------------------------------------------------------
-        const task_group_sptr& getParentGroup() const
+        task_group_base* getParentGroup() const
         {
             validate();
             return spTask_->getParentGroup();
         }
 
+        //------------------------------------------------------------------------------------------
+        void rearmInGroup(task_group_base *pParentGroup)
+        {
+            validate();
+            spTask_->rearmInGroup(pParentGroup);
+        }
+
         //------------------------------------------------------------------------------------------
         uint64_t getUID() const
         {
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <string>
+#include <cstdint>
+#include <type_traits>
+#include <string_view>
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Name given to a task or a group when it's created. It's only a view on the strings it's made
+    // of, nothing is allocated until a context converts it to a std::string. Contexts that don't
+    // care about names, like the empty ones, never pay for them.
+    // A name can be a sequence of texts and numbers, task_name("Batch ", 3, "/", 8) for instance,
+    // the numbers are only formatted when the name is materialized.
+    // The viewed strings must outlive the creation of the task, which is when the contexts see
+    // the name: literals, or strings owned by the caller.
+    //
+    class task_name
+    {
+    public:
+        static constexpr int32_t max_pieces = 6;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        task_name()
+            : pieceCount_(0)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Plain names
+        task_name(const char *name)
+            : task_name(std::string_view(name))
+        {}
+
+        task_name(const std::string &name)
+            : task_name(std::string_view(name))
+        {}
+
+        task_name(std::string_view name)
+            : pieceCount_(0)
+        {
+            append(name);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Concatenation of texts and integers
+        template<typename... _Pieces, typename = std::enable_if_t<(sizeof...(_Pieces) > 1)>>
+        task_name(const _Pieces &...pieces)
+            : pieceCount_(0)
+        {
+            static_assert(sizeof...(_Pieces) <= max_pieces, "Too many pieces for a task_name.");
+            (append(pieces), ...);
+        }
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool empty() const
+        {
+            for (auto i = 0; i < pieceCount_; ++i)
+            {
+                if (pieces_[i].isNumber || !pieces_[i].text.empty())
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Builds the full name, this is where the allocation happens
+        std::string str() const
+        {
+            std::string name;
+            for (auto i = 0; i < pieceCount_; ++i)
+            {
+                if (pieces_[i].isNumber)
+                {
+                    name += std::to_string(pieces_[i].number);
+                }
+                else
+                {
+                    name += pieces_[i].text;
+                }
+            }
+            return name;
+        }
+
+        operator std::string() const
+        {
+            return str();
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void append(std::string_view text)
+        {
+            pieces_[pieceCount_++] = piece{ text, 0, false };
+        }
+
+        void append(int64_t number)
+        {
+            pieces_[pieceCount_++] = piece{ {}, number, true };
+        }
+
+    private:
+        struct piece
+        {
+            std::string_view    text;
+            int64_t             number;
+            bool                isNumber;
+        };
+
+        int32_t pieceCount_;
+        piece   pieces_[max_pieces];
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
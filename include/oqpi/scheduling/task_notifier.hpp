@@ -28,6 +28,7 @@ namespace oqpi {
         //------------------------------------------------------------------------------------------
         void wait()     { oqpi_checkf(false, "Can't wait on a fire_and_forget task"); }
         void notify()   {}
+        void reset()    {}
     };
     //----------------------------------------------------------------------------------------------
 
@@ -64,6 +65,7 @@ namespace oqpi {
         //------------------------------------------------------------------------------------------
         void wait()     { event_.wait();    }
         void notify()   { event_.notify();  }
+        void reset()    { event_.reset();   }
 
     private:
         //------------------------------------------------------------------------------------------
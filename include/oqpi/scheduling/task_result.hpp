@@ -1,31 +1,151 @@
 #pragma once
 
+#include <new>
+#include <atomic>
+#include <utility>
+#include <stdexcept>
+
 
 namespace oqpi {
 
+    //----------------------------------------------------------------------------------------------
+    template<typename _ReturnType>
+    class task_future;
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Thrown when reading a result that is not there: it was taken already, or the task was
+    // cancelled before it ran.
+    class no_result_error
+        : public std::logic_error
+    {
+    public:
+        using std::logic_error::logic_error;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
     //----------------------------------------------------------------------------------------------
     // Helper class containing an arbitrary result of a task.
-    // _ReturnType must be default constructible and copyable or movable.
+    // The result is constructed in place, inside the task, from what the task returns. It only
+    // needs to be movable, or copyable, and can be taken out of the task once without any copy,
+    // see task_future. Several threads can try to take it at once, only one of them gets it.
     template<typename _ReturnType>
     class task_result
     {
+        template<typename> friend class task_future;
+
     protected:
-        task_result() = default;
+        //------------------------------------------------------------------------------------------
+        task_result()
+            : hasResult_(false)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        task_result(task_result &&other)
+            : hasResult_(false)
+        {
+            if (other.hasResult())
+            {
+                setResult(other.takeResult());
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        task_result& operator =(task_result &&rhs)
+        {
+            if (this != &rhs)
+            {
+                resetResult();
+                if (rhs.hasResult())
+                {
+                    setResult(rhs.takeResult());
+                }
+            }
+            return (*this);
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~task_result()
+        {
+            resetResult();
+        }
 
     protected:
+        //------------------------------------------------------------------------------------------
         template<typename _Func>
         void run(_Func &&f)
         {
-            result_ = f();
+            resetResult();
+            // Constructed right from the returned value, no copy nor move
+            new (&storage_) _ReturnType(f());
+            hasResult_.store(true, std::memory_order_release);
         }
 
-        _ReturnType getResult() const
+        //------------------------------------------------------------------------------------------
+        template<typename _Value>
+        void setResult(_Value &&value)
         {
-            return result_;
+            resetResult();
+            new (&storage_) _ReturnType(std::forward<_Value>(value));
+            hasResult_.store(true, std::memory_order_release);
         }
 
-    protected:
-        _ReturnType result_;
+        //------------------------------------------------------------------------------------------
+        const _ReturnType& getResult() const
+        {
+            if (!hasResult())
+            {
+                throw no_result_error("No result, it was taken already or the task was cancelled");
+            }
+            return *result();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Moves the result out, it can't be accessed anymore afterwards. The flag is cleared
+        // first so that only one of the threads taking it at once moves and destroys it.
+        _ReturnType takeResult()
+        {
+            if (!hasResult_.exchange(false, std::memory_order_acq_rel))
+            {
+                throw no_result_error("No result, it was taken already or the task was cancelled");
+            }
+            _ReturnType value(std::move(*result()));
+            result()->~_ReturnType();
+            return value;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool hasResult() const
+        {
+            return hasResult_.load(std::memory_order_acquire);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void resetResult()
+        {
+            if (hasResult_.exchange(false, std::memory_order_acq_rel))
+            {
+                result()->~_ReturnType();
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        _ReturnType* result()
+        {
+            return std::launder(reinterpret_cast<_ReturnType*>(&storage_));
+        }
+
+        const _ReturnType* result() const
+        {
+            return std::launder(reinterpret_cast<const _ReturnType*>(&storage_));
+        }
+
+    private:
+        alignas(_ReturnType) unsigned char  storage_[sizeof(_ReturnType)];
+        std::atomic<bool>                   hasResult_;
     };
     //----------------------------------------------------------------------------------------------
 
@@ -35,6 +155,8 @@ namespace oqpi {
     template<>
     class task_result<void>
     {
+        template<typename> friend class task_future;
+
     protected:
         template<typename _Func>
         void run(_Func &&f)
@@ -43,6 +165,9 @@ namespace oqpi {
         }
 
         void getResult() const {}
+        void takeResult() {}
+        bool hasResult() const { return true; }
+        void resetResult() {}
     };
     //----------------------------------------------------------------------------------------------
 
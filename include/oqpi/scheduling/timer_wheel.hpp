@@ -0,0 +1,535 @@
+#pragma once
+
+#include <mutex>
+#include <limits>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <cstdint>
+#include <functional>
+
+#include "oqpi/platform.hpp"
+#include "oqpi/error_handling.hpp"
+#include "oqpi/scheduling/task_handle.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    class timer_wheel;
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // A timer pending in a timer_wheel. Either holds a task to add once, or a function creating
+    // the task to add at each period.
+    class timer_entry
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        timer_entry(timer_wheel &wheel, task_handle hTask, std::function<task_handle()> makeTask, int64_t periodTicks)
+            : pWheel_(&wheel)
+            , hTask_(std::move(hTask))
+            , makeTask_(std::move(makeTask))
+            , periodTicks_(periodTicks)
+            , expiry_(0)
+            , level_(-1)
+            , slot_(-1)
+            , pPrev_(nullptr)
+            , pNext_(nullptr)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        timer_entry(const timer_entry &)             = delete;
+        timer_entry& operator =(const timer_entry &) = delete;
+
+    private:
+        friend class timer_wheel;
+        friend class timer_handle;
+
+        // Wheel this timer was added to
+        timer_wheel                    *pWheel_;
+        // Task to add, invalid for periodic timers
+        task_handle                     hTask_;
+        // Creates the task to add at each period, empty for one shot timers
+        std::function<task_handle()>    makeTask_;
+        // 0 for one shot timers
+        int64_t                         periodTicks_;
+        // Tick at which the timer expires
+        int64_t                         expiry_;
+        // Slot of the wheel the timer is linked to, -1 if not pending
+        int32_t                         level_;
+        int32_t                         slot_;
+        // Intrusive links of the slot
+        timer_entry                    *pPrev_;
+        timer_entry                    *pNext_;
+        // Keeps the entry alive while it's pending
+        std::shared_ptr<timer_entry>    spSelf_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Hierarchical timer wheel: LEVELS wheels of SLOTS slots each, a slot of the level L covering
+    // SLOTS^L ticks. A timer goes to the lowest level able to hold it, and is moved down a level
+    // (cascaded) when the wheel reaches the range of its slot. Timers further away than the last
+    // level can hold are parked in its last slot and placed again when it's cascaded.
+    //
+    // Slots are intrusive lists and each level keeps a bitmask of its non empty slots, so adding
+    // and cancelling a timer is O(1), and so is finding the next tick at which something has to
+    // happen, which lets the wheel jump over empty ticks.
+    //
+    // The wheel does not own any thread, it's driven by calling advance. nextExpiry can be read
+    // without locking to know when advance has to be called next.
+    //
+    class timer_wheel
+    {
+        using lock_t = std::lock_guard<std::mutex>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr int64_t no_expiry = std::numeric_limits<int64_t>::max();
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Times are in nanoseconds, the start time is the one of the first tick
+        explicit timer_wheel(int64_t resolutionNs = 1000000, int64_t startNs = 0)
+            : resolutionNs_(resolutionNs > 0 ? resolutionNs : 1)
+            , now_(startNs / resolutionNs_)
+            , occupied_{}
+            , slots_{}
+            , count_(0)
+            , nextExpiry_(no_expiry)
+        {
+            oqpi_checkf(resolutionNs > 0, "Invalid timer resolution: %lld", (long long)resolutionNs);
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~timer_wheel()
+        {
+            clear();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        timer_wheel(const timer_wheel &)             = delete;
+        timer_wheel& operator =(const timer_wheel &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Changes the resolution and the current time, the wheel has to be empty
+        void reset(int64_t resolutionNs, int64_t startNs)
+        {
+            lock_t __l(mutex_);
+            if (oqpi_ensuref(count_ == 0, "Can't reset a timer wheel with pending timers.") && oqpi_ensure(resolutionNs > 0))
+            {
+                resolutionNs_   = resolutionNs;
+                now_            = startNs / resolutionNs_;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        int64_t getResolution() const
+        {
+            return resolutionNs_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Adds a timer expiring at the specified time, rounded up to the next tick.
+        // A periodic timer first expires at that time then every period.
+        // Returns true if it's now the first timer to expire.
+        bool add(const std::shared_ptr<timer_entry> &spTimer, int64_t expiryNs, int64_t periodNs = 0)
+        {
+            oqpi_check(spTimer && spTimer->pWheel_ == this);
+
+            lock_t __l(mutex_);
+            if (spTimer->level_ >= 0)
+            {
+                unlink(*spTimer);
+            }
+
+            spTimer->expiry_        = expiryNs / resolutionNs_ + (expiryNs % resolutionNs_ > 0 ? 1 : 0);
+            spTimer->periodTicks_   = periodNs > 0 ? std::max<int64_t>(periodNs / resolutionNs_, 1) : 0;
+            spTimer->spSelf_        = spTimer;
+            link(*spTimer);
+
+            const auto previous = nextExpiry_.load(std::memory_order_relaxed);
+            updateNextExpiry();
+            return nextExpiry_.load(std::memory_order_relaxed) < previous;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the timer was not pending anymore
+        bool cancel(timer_entry &timer)
+        {
+            std::shared_ptr<timer_entry> spSelf;
+            {
+                lock_t __l(mutex_);
+                if (timer.level_ < 0)
+                {
+                    return false;
+                }
+
+                unlink(timer);
+                // Released once unlocked, it could be the last reference
+                spSelf = std::move(timer.spSelf_);
+                updateNextExpiry();
+            }
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool isPending(const timer_entry &timer) const
+        {
+            lock_t __l(mutex_);
+            return timer.level_ >= 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Expires every timer due at the specified time and appends their task to the list.
+        // Periodic timers are added back for their next period, if the wheel fell behind by more
+        // than a period the missed periods are skipped.
+        void advance(int64_t nowNs, std::vector<task_handle> &tasks)
+        {
+            auto &expired = this_thread_expired();
+            {
+                lock_t __l(mutex_);
+                const auto target = nowNs / resolutionNs_;
+                while (true)
+                {
+                    const auto next = nextEventTick();
+                    if (next > target)
+                    {
+                        now_ = std::max(now_, target + 1);
+                        break;
+                    }
+
+                    now_ = next;
+                    processTick(expired);
+                    ++now_;
+                }
+                updateNextExpiry();
+            }
+
+            // Tasks are created outside of the lock, and the entries of one shot timers released
+            for (auto &spTimer : expired)
+            {
+                if (spTimer->makeTask_)
+                {
+                    auto hTask = spTimer->makeTask_();
+                    if (hTask.isValid())
+                    {
+                        tasks.emplace_back(std::move(hTask));
+                    }
+                }
+                else
+                {
+                    tasks.emplace_back(spTimer->hTask_);
+                }
+            }
+            expired.clear();
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Time in nanoseconds from which advance has something to do, can be earlier than the
+        // actual expiry of the first timer if timers have to be cascaded in between.
+        // no_expiry if there's no pending timer.
+        int64_t nextExpiry() const
+        {
+            return nextExpiry_.load();
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool empty() const
+        {
+            return size() == 0;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Number of pending timers
+        size_t size() const
+        {
+            return count_.load(std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Cancels every pending timer
+        void clear()
+        {
+            std::vector<std::shared_ptr<timer_entry>> timers;
+            {
+                lock_t __l(mutex_);
+                for (auto level = 0; level < LEVELS; ++level)
+                {
+                    for (auto slot = 0; slot < SLOTS; ++slot)
+                    {
+                        while (slots_[level][slot])
+                        {
+                            auto &timer = *slots_[level][slot];
+                            unlink(timer);
+                            timers.emplace_back(std::move(timer.spSelf_));
+                        }
+                    }
+                }
+                updateNextExpiry();
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr int32_t SLOT_BITS  = 6;
+        static constexpr int32_t SLOTS      = 1 << SLOT_BITS;
+        static constexpr int32_t LEVELS     = 4;
+
+        //------------------------------------------------------------------------------------------
+        static int64_t level_shift(int32_t level)
+        {
+            return int64_t(level) * SLOT_BITS;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void link(timer_entry &timer)
+        {
+            // Timers already due go to the current tick
+            timer.expiry_ = std::max(timer.expiry_, now_);
+
+            const auto delta = timer.expiry_ - now_;
+            auto level = 0;
+            while (level < LEVELS - 1 && delta >= (int64_t(1) << level_shift(level + 1)))
+            {
+                ++level;
+            }
+
+            int32_t slot;
+            if (delta >= (int64_t(1) << level_shift(LEVELS)))
+            {
+                // Too far away, park it in the last slot of the last level
+                slot = int32_t(((now_ >> level_shift(level)) + SLOTS - 1) & (SLOTS - 1));
+            }
+            else
+            {
+                slot = int32_t((timer.expiry_ >> level_shift(level)) & (SLOTS - 1));
+            }
+
+            auto &pHead     = slots_[level][slot];
+            timer.level_    = level;
+            timer.slot_     = slot;
+            timer.pPrev_    = nullptr;
+            timer.pNext_    = pHead;
+            if (pHead)
+            {
+                pHead->pPrev_ = &timer;
+            }
+            pHead = &timer;
+            occupied_[level] |= uint64_t(1) << slot;
+            count_.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        void unlink(timer_entry &timer)
+        {
+            auto &pHead = slots_[timer.level_][timer.slot_];
+            if (timer.pPrev_)
+            {
+                timer.pPrev_->pNext_ = timer.pNext_;
+            }
+            else
+            {
+                pHead = timer.pNext_;
+            }
+            if (timer.pNext_)
+            {
+                timer.pNext_->pPrev_ = timer.pPrev_;
+            }
+            if (pHead == nullptr)
+            {
+                occupied_[timer.level_] &= ~(uint64_t(1) << timer.slot_);
+            }
+
+            timer.level_    = -1;
+            timer.slot_     = -1;
+            timer.pPrev_    = nullptr;
+            timer.pNext_    = nullptr;
+            count_.fetch_sub(1, std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Unlinks the whole content of a slot and returns its first timer
+        timer_entry* detach(int32_t level, int32_t slot)
+        {
+            auto pFirst = slots_[level][slot];
+            slots_[level][slot] = nullptr;
+            occupied_[level] &= ~(uint64_t(1) << slot);
+            for (auto pTimer = pFirst; pTimer; pTimer = pTimer->pNext_)
+            {
+                pTimer->level_ = -1;
+                pTimer->slot_  = -1;
+                count_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return pFirst;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Processes the current tick: cascades the upper levels if the lower ones wrapped around
+        // then expires the timers of the current slot
+        void processTick(std::vector<std::shared_ptr<timer_entry>> &expired)
+        {
+            for (auto level = 1; level < LEVELS; ++level)
+            {
+                // Cascades only happen at the boundaries of the level below
+                if ((now_ & ((int64_t(1) << level_shift(level)) - 1)) != 0)
+                {
+                    break;
+                }
+
+                const auto slot = int32_t((now_ >> level_shift(level)) & (SLOTS - 1));
+                for (auto pTimer = detach(level, slot); pTimer;)
+                {
+                    auto pNext = pTimer->pNext_;
+                    link(*pTimer);
+                    pTimer = pNext;
+                }
+            }
+
+            for (auto pTimer = detach(0, int32_t(now_ & (SLOTS - 1))); pTimer;)
+            {
+                auto pNext = pTimer->pNext_;
+                if (pTimer->periodTicks_ > 0)
+                {
+                    // Its next period, the missed ones are skipped
+                    expired.emplace_back(pTimer->spSelf_);
+                    pTimer->expiry_ += pTimer->periodTicks_;
+                    if (pTimer->expiry_ <= now_)
+                    {
+                        pTimer->expiry_ += ((now_ - pTimer->expiry_) / pTimer->periodTicks_ + 1) * pTimer->periodTicks_;
+                    }
+                    link(*pTimer);
+                }
+                else
+                {
+                    expired.emplace_back(std::move(pTimer->spSelf_));
+                }
+                pTimer = pNext;
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // First tick, from the current one, at which a slot has to be expired or cascaded
+        int64_t nextEventTick() const
+        {
+            auto next = no_expiry;
+            for (auto level = 0; level < LEVELS; ++level)
+            {
+                const auto bits = occupied_[level];
+                if (bits == 0)
+                {
+                    continue;
+                }
+
+                // The current slot of a level is due now only if we're at its boundary (always
+                // the case for the first level), otherwise it's due a full turn later
+                const auto shift    = level_shift(level);
+                const auto base     = now_ >> shift;
+                const auto aligned  = (now_ & ((int64_t(1) << shift) - 1)) == 0;
+                const auto first    = int32_t((base + (aligned ? 0 : 1)) & (SLOTS - 1));
+                const auto rotated  = first == 0 ? bits : ((bits >> first) | (bits << (SLOTS - first)));
+                const auto offset   = lowest_bit_index(rotated) + (aligned ? 0 : 1);
+                next = std::min(next, (base + offset) << shift);
+            }
+            return next;
+        }
+
+        //------------------------------------------------------------------------------------------
+        void updateNextExpiry()
+        {
+            const auto next = nextEventTick();
+            nextExpiry_.store(next == no_expiry ? no_expiry : next * resolutionNs_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        static int32_t lowest_bit_index(uint64_t bits)
+        {
+#if OQPI_PLATFORM_WIN
+            unsigned long index = 0;
+            _BitScanForward64(&index, bits);
+            return int32_t(index);
+#else
+            return int32_t(__builtin_ctzll(bits));
+#endif
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Per thread buffer of the timers expired by advance, reused from one call to the other
+        static std::vector<std::shared_ptr<timer_entry>>& this_thread_expired()
+        {
+            static thread_local std::vector<std::shared_ptr<timer_entry>> expired;
+            return expired;
+        }
+
+    private:
+        mutable std::mutex      mutex_;
+        int64_t                 resolutionNs_;
+        // Next tick to process
+        int64_t                 now_;
+        // One bit per non empty slot
+        uint64_t                occupied_[LEVELS];
+        timer_entry            *slots_[LEVELS][SLOTS];
+        std::atomic<size_t>     count_;
+        // In nanoseconds, see nextExpiry
+        std::atomic<int64_t>    nextExpiry_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Handle on a timer, can be used to cancel it. Cancelling a periodic timer stops it.
+    class timer_handle
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        // Constructs an invalid handle
+        timer_handle() = default;
+
+        //------------------------------------------------------------------------------------------
+        explicit timer_handle(std::shared_ptr<timer_entry> spTimer)
+            : spTimer_(std::move(spTimer))
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return spTimer_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Returns false if the timer already expired (or was already cancelled), in which case its
+        // task has been or is being added to the scheduler
+        bool cancel()
+        {
+            return oqpi_ensure(isValid()) && spTimer_->pWheel_->cancel(*spTimer_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Whether the timer is still waiting to expire, always true for periodic timers until
+        // they're cancelled
+        bool isPending() const
+        {
+            return oqpi_ensure(isValid()) && spTimer_->pWheel_->isPending(*spTimer_);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Task added once the timer expires, invalid for periodic timers
+        const task_handle& getTask() const
+        {
+            oqpi_check(isValid());
+            return spTimer_->hTask_;
+        }
+
+    private:
+        std::shared_ptr<timer_entry> spTimer_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
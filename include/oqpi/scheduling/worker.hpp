@@ -1,5 +1,7 @@
 #pragma once
 
+#include <chrono>
+
 #include "oqpi/scheduling/worker_base.hpp"
 
 
@@ -14,8 +16,8 @@ namespace oqpi {
     public:
         //------------------------------------------------------------------------------------------
 		template<typename... _Args>
-        worker(_Scheduler &sc, int32_t id, const worker_config &config, _Args &&...args)
-            : worker_base(id, config)
+        worker(_Scheduler &sc, int32_t id, int32_t index, const worker_config &config, _Args &&...args)
+            : worker_base(id, index, config)
             , _WorkerContext(this, std::forward<_Args>(args)...)
             , scheduler_(sc)
             , notifier_()
@@ -77,6 +79,12 @@ namespace oqpi {
             notifier_.wait();
         }
 
+        //------------------------------------------------------------------------------------------
+        virtual bool waitFor(int64_t timeoutNs) override final
+        {
+            return notifier_.waitFor(std::chrono::nanoseconds(timeoutNs));
+        }
+
         //------------------------------------------------------------------------------------------
         virtual bool tryWait() override final
         {
@@ -89,19 +97,68 @@ namespace oqpi {
             notifier_.notifyOne();
         }
 
+        //------------------------------------------------------------------------------------------
+        virtual void resetNotifications() override final
+        {
+            reset_notifications(notifier_, 0);
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void runInline(task_handle &hTask) override final
+        {
+            executeTask(hTask);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Runs a task found by the scheduler while one of our tasks waits for another one
+        virtual bool helpOnce() override final
+        {
+            auto hTask = scheduler_.signalHelpingWorker(*this);
+            if (!hTask.isValid())
+            {
+                return false;
+            }
+
+            executeTask(hTask);
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void notifyWhenDone(task_base &awaited) override final
+        {
+            // A spurious wake up later on is harmless
+            awaited.addContinuation([this] { notify(); });
+        }
+
+        //------------------------------------------------------------------------------------------
+        virtual void park(task_base &awaited) override final
+        {
+            auto hTask = scheduler_.parkHelpingWorker(*this, awaited);
+            if (hTask.isValid())
+            {
+                executeTask(hTask);
+            }
+        }
+
         //------------------------------------------------------------------------------------------
         virtual void run() override final
         {
             // Inform the context that we're starting the worker thread
             _WorkerContext::worker_onStart();
+            // Tasks waiting on this thread run other tasks in the meantime
+            this_thread_wait_helper() = this;
 
             // This is the worker's main loop
             while (isRunning())
             {
                 // Inform the context that we're potentially going idle while waiting for a task to work on
                 _WorkerContext::worker_onIdle();
-                // Signal to the scheduler that we want a task to work on
-                scheduler_.signalAvailableWorker(*this);
+                // Signal to the scheduler that we want a task to work on, the thread stops if the
+                // worker is retired instead, see elastic_policy
+                if (!scheduler_.signalAvailableWorker(*this))
+                {
+                    break;
+                }
                 // At this point we either have a task to work on or we've been waken up to quit the thread
                 oqpi_check(!worker_base::isAvailable() || !isRunning());
                 // We consider ourselves active either way
@@ -112,12 +169,7 @@ namespace oqpi {
                 {
                     if (oqpi_ensure(worker_base::hTask_.isValid()))
                     {
-                        // Inform the context that we're about to start the execution of a new task
-                        _WorkerContext::worker_onPreExecute(worker_base::hTask_);
-                        // Actually execute the task
-                        worker_base::hTask_.execute();
-                        // Inform the context that we just finished the execution of a task
-                        _WorkerContext::worker_onPostExecute(worker_base::hTask_);
+                        executeTask(worker_base::hTask_);
                         // Reset the task, can potentially free the memory if there's no more reference to that task
                         worker_base::hTask_.reset();
                     }
@@ -126,6 +178,7 @@ namespace oqpi {
 
             // Just to make sure the memory is released (will happen in the destructor of the worker anyway)
             worker_base::hTask_.reset();
+            this_thread_wait_helper() = nullptr;
 
             // Inform the context that we're stopping the worker thread
             _WorkerContext::worker_onStop();
@@ -133,7 +186,37 @@ namespace oqpi {
 
     private:
         //------------------------------------------------------------------------------------------
-        // Reference to the parent scheduler, used to call signalAvailableWorker
+        void executeTask(task_handle &hTask)
+        {
+            // Inform the context that we're about to start the execution of a new task
+            _WorkerContext::worker_onPreExecute(hTask);
+            // Actually execute the task, it can be suspended if it runs on a fiber
+            scheduler_.executeTask(hTask);
+            // Inform the context that we just finished the execution of a task
+            _WorkerContext::worker_onPostExecute(hTask);
+            // Let the scheduler know, it keeps track of the deadlines
+            scheduler_.signalTaskExecuted(hTask);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Notifiers that can discard their pending notifications in one go
+        template<typename _N>
+        static auto reset_notifications(_N &notifier, int) -> decltype(notifier.reset(), void())
+        {
+            notifier.reset();
+        }
+        //------------------------------------------------------------------------------------------
+        // Counting notifiers (semaphores) have to be decremented until they reach 0
+        template<typename _N>
+        static void reset_notifications(_N &notifier, long)
+        {
+            while (notifier.tryWait());
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        // Reference to the parent scheduler, used to call signalAvailableWorker and signalTaskExecuted
         _Scheduler         &scheduler_;
         // The underlying thread
         _Thread             thread_;
@@ -1,6 +1,8 @@
 #pragma once
 
+#include <chrono>
 #include <string>
+#include <algorithm>
 #include <atomic>
 #include <memory>
 
@@ -39,6 +41,81 @@ namespace oqpi {
     //----------------------------------------------------------------------------------------------
 
 
+    //----------------------------------------------------------------------------------------------
+    // What a worker does when it runs out of tasks: spin for a while, checking the queues between
+    // each pause instruction, then yield its time slice a few times, then go to sleep until it's
+    // notified. Spinning and yielding burn CPU but save the cost of a sleep/wake up cycle when the
+    // next task comes in shortly after.
+    // With an adaptive spin, the spin count of each worker shrinks every time spinning did not
+    // find anything and grows back every time it did, within [minSpinCount, spinCount]. It never
+    // goes below 1 spin when spinCount allows it, it could not grow back from 0.
+    // The default policy goes to sleep right away.
+    struct idle_policy
+    {
+        idle_policy()
+            : spinCount(0)
+            , minSpinCount(0)
+            , yieldCount(0)
+            , adaptiveSpin(true)
+        {}
+
+        int32_t spinCount;
+        int32_t minSpinCount;
+        int32_t yieldCount;
+        bool    adaptiveSpin;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Lets the scheduler grow and shrink the workers of a config between worker_config::count
+    // and maxCount. Extra workers are started when the tasks their priorities can take wait in
+    // the queues for longer than spawnWaitThreshold, for at least as long, one at a time. Extra
+    // workers sleeping for retireIdleTime without being notified stop their thread until needed
+    // again. Workers beyond count are created at registration, only their threads come and go.
+    // The default policy keeps count workers.
+    struct elastic_policy
+    {
+        elastic_policy()
+            : maxCount(0)
+            , spawnWaitThreshold(std::chrono::milliseconds(1))
+            , retireIdleTime(std::chrono::seconds(1))
+        {}
+
+        int32_t                     maxCount;
+        std::chrono::nanoseconds    spawnWaitThreshold;
+        std::chrono::nanoseconds    retireIdleTime;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // The phase of the idle policy during which a worker found its task, busy meaning that the
+    // worker found it right away
+    enum class idle_phase
+    {
+        busy,
+        spin,
+        yield,
+        park,
+
+        count
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Snapshot of the idle statistics of a worker
+    struct idle_stats
+    {
+        // Number of tasks found in each phase
+        uint64_t    found[int(idle_phase::count)];
+        // Current spin count of the worker
+        int32_t     spinBudget;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
     //----------------------------------------------------------------------------------------------
     // A config used to create one or several workers when registering to the scheduler
     struct worker_config
@@ -47,11 +124,29 @@ namespace oqpi {
             : threadAttributes("oqpi::worker")
             , workerPrio(worker_priority::wprio_any)
             , count(1)
+            , numaNode(0)
         {}
 
         thread_attributes   threadAttributes;
         worker_priority     workerPrio;
+        // Number of workers, the minimum one if the pool is elastic
         int32_t             count;
+        // NUMA node the workers belong to, the scheduler keeps one set of queues per node.
+        // The thread affinity should be set accordingly.
+        int32_t             numaNode;
+        idle_policy         idlePolicy;
+        elastic_policy      elastic;
+
+        // Number of workers created for this config
+        int32_t maxCount() const
+        {
+            return std::max(count, elastic.maxCount);
+        }
+
+        bool isElastic() const
+        {
+            return elastic.maxCount > count;
+        }
     };
     //----------------------------------------------------------------------------------------------
 
@@ -69,13 +164,22 @@ namespace oqpi {
     // Base class for workers, it's basically a wrapper around a thread with a notification
     // object to be able to wake it up/put it asleep.
     class worker_base
+        : public wait_helper
     {
     public:
         //------------------------------------------------------------------------------------------
-        worker_base(int id, const worker_config &config)
-            : id_(config.count > 1 ? id : -1)
+        worker_base(int id, int index, const worker_config &config)
+            : id_(config.maxCount() > 1 ? id : -1)
+            , index_(index)
             , config_(config)
-        {}
+            , spinBudget_(config.idlePolicy.spinCount)
+            , priorityCursor_(0)
+        {
+            for (auto &found : idleFound_)
+            {
+                found.store(0, std::memory_order_relaxed);
+            }
+        }
 
         //------------------------------------------------------------------------------------------
         virtual ~worker_base()
@@ -115,12 +219,74 @@ namespace oqpi {
             return id_;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Position of this worker in the scheduler's list of workers
+        int getIndex() const
+        {
+            return index_;
+        }
+
+        //------------------------------------------------------------------------------------------
+        int getNumaNode() const
+        {
+            return config_.numaNode;
+        }
+
         //------------------------------------------------------------------------------------------
         const worker_config& getConfig() const
         {
             return config_;
         }
 
+        //------------------------------------------------------------------------------------------
+        // Number of spin iterations to go through before yielding
+        int32_t getSpinBudget() const
+        {
+            return spinBudget_.load(std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Called by the worker's thread each time it finds a task, updates the stats and adapts
+        // the spin budget
+        void onTaskFound(idle_phase phase)
+        {
+            // Only this worker writes its stats, no need for a read-modify-write
+            auto &found = idleFound_[int(phase)];
+            found.store(found.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+
+            const auto &policy = config_.idlePolicy;
+            if (policy.adaptiveSpin && phase != idle_phase::busy)
+            {
+                // Growing back needs a hit while spinning, hence at least one spin
+                const auto minBudget = std::min(policy.spinCount, std::max(policy.minSpinCount, 1));
+                auto budget = spinBudget_.load(std::memory_order_relaxed);
+                budget = (phase == idle_phase::spin)
+                    ? std::min(policy.spinCount, std::max(budget * 2, 1))
+                    : std::max(minBudget, budget / 2);
+                spinBudget_.store(budget, std::memory_order_relaxed);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Position of the worker in the weighted priority order of the scheduler, increments each
+        // time it's called. Only called from the worker's thread.
+        uint32_t nextPriorityCursor()
+        {
+            return priorityCursor_++;
+        }
+
+        //------------------------------------------------------------------------------------------
+        idle_stats getIdleStats() const
+        {
+            idle_stats stats;
+            for (auto phase = 0; phase < int(idle_phase::count); ++phase)
+            {
+                stats.found[phase] = idleFound_[phase].load(std::memory_order_relaxed);
+            }
+            stats.spinBudget = getSpinBudget();
+            return stats;
+        }
+
         //------------------------------------------------------------------------------------------
         std::string getName() const
         {
@@ -139,9 +305,19 @@ namespace oqpi {
         //------------------------------------------------------------------------------------------
         virtual void wait()     = 0;
         //------------------------------------------------------------------------------------------
+        // Returns false if nothing was notified before the time out
+        virtual bool waitFor(int64_t timeoutNs) = 0;
+        //------------------------------------------------------------------------------------------
         virtual bool tryWait()  = 0;
         //------------------------------------------------------------------------------------------
         virtual void notify()   = 0;
+        //------------------------------------------------------------------------------------------
+        // Discards every pending notification
+        virtual void resetNotifications() = 0;
+        //------------------------------------------------------------------------------------------
+        // Executes a task on the worker's thread as if it had been popped, has to be called from
+        // that thread, see scheduler::runInline
+        virtual void runInline(task_handle &hTask) = 0;
 
     protected:
         //------------------------------------------------------------------------------------------
@@ -157,10 +333,18 @@ namespace oqpi {
     protected:
         // Id of this worker, useful when a config is shared between several workers
         const int           id_;
+        // Index of this worker among all the workers of the scheduler
+        const int           index_;
         // The config used to create this thread
         const worker_config config_;
         // The task the thread is currently working on, or an invalid handle if the worker is idle
         task_handle         hTask_;
+        // Current spin count, see idle_policy
+        std::atomic<int32_t>    spinBudget_;
+        // Number of tasks found per idle phase
+        std::atomic<uint64_t>   idleFound_[int(idle_phase::count)];
+        // See scheduler_config::priorityPolicy
+        uint32_t                priorityCursor_;
     };
     //----------------------------------------------------------------------------------------------
 
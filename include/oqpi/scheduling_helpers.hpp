@@ -3,25 +3,40 @@
 #include "oqpi/threading/thread.hpp"
 
 #include "oqpi/synchronization/event.hpp"
+#include "oqpi/synchronization/notifier.hpp"
 #include "oqpi/synchronization/semaphore.hpp"
 
 #include "oqpi/scheduling/task.hpp"
+#include "oqpi/scheduling/co_task.hpp"
 #include "oqpi/scheduling/scheduler.hpp"
 #include "oqpi/scheduling/task_type.hpp"
+#include "oqpi/scheduling/task_future.hpp"
 #include "oqpi/scheduling/task_handle.hpp"
+#include "oqpi/scheduling/continuation.hpp"
 #include "oqpi/scheduling/task_context.hpp"
 #include "oqpi/scheduling/group_context.hpp"
 #include "oqpi/scheduling/parallel_group.hpp"
 #include "oqpi/scheduling/sequence_group.hpp"
+#include "oqpi/scheduling/task_graph.hpp"
 
 #include "oqpi/parallel_algorithms/parallel_for.hpp"
 #include "oqpi/parallel_algorithms/simple_partitioner.hpp"
 
+#include "oqpi/ring_queue.hpp"
+#include "oqpi/slab_allocator.hpp"
 #include "oqpi/concurrent_queue.hpp"
 
 
 namespace oqpi {
 
+    //----------------------------------------------------------------------------------------------
+    // Scheduler along with the functions making and scheduling tasks and groups on it.
+    //
+    // Each toolkit has its own scheduler, workers and queues, nothing is shared between toolkits.
+    // Latency critical work can be kept apart from bulk work by giving each its own toolkit, with
+    // workers on different cores for instance, so that one can't delay the other.
+    // See helpers for a toolkit reachable from anywhere.
+    //
     template
     <
           typename _Scheduler           = scheduler<concurrent_queue>
@@ -31,11 +46,14 @@ namespace oqpi {
         , typename _DefaultTaskContext  = empty_task_context
         // Type of events used for notification when a task is done
         , typename _EventType           = manual_reset_event_interface<>
+        // Allocator of the tasks and groups, slab_allocator<char> to take them from the slab pool
+        , typename _Allocator           = std::allocator<char>
     >
-    struct helpers
+    class toolkit
     {
+    public:
         //------------------------------------------------------------------------------------------
-        using self_type = helpers<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType>;
+        using self_type = toolkit<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType, _Allocator>;
 
         //------------------------------------------------------------------------------------------
         using default_thread = thread_interface<>;
@@ -44,23 +62,34 @@ namespace oqpi {
         static constexpr auto default_priority = task_priority::normal;
 
 
+    public:
         //------------------------------------------------------------------------------------------
-        // Static instance
-        static _Scheduler scheduler_;
-        static _Scheduler& scheduler() { return scheduler_; }
+        explicit toolkit(const scheduler_config &config = scheduler_config())
+            : scheduler_(config)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable, the tasks and groups made by the toolkit refer to its scheduler
+        toolkit(const self_type &)                  = delete;
+        self_type& operator =(const self_type &)    = delete;
+
+
+    public:
+        //------------------------------------------------------------------------------------------
+        _Scheduler& scheduler() { return scheduler_; }
+        const _Scheduler& scheduler() const { return scheduler_; }
 
 
         //------------------------------------------------------------------------------------------
         // Start the scheduler with a default workers configuration
         template<typename _WorkerContext = empty_worker_context>
-        inline static void start_default_scheduler(int32_t workerCount = default_thread::hardware_concurrency())
+        inline void start_default_scheduler(int32_t workerCount = default_thread::hardware_concurrency(), core_affinity coreAffinityMask = core_affinity::all_cores)
         {
-            // Use the default thread and semaphore (without any layer)
-            using default_semaphore = semaphore_interface<>;
+            // Use the default thread (without any layer) and notifier
 
             auto config = oqpi::worker_config{};
-            // Let the workers roam on all cores.
-            config.threadAttributes.coreAffinityMask_   = oqpi::core_affinity::all_cores;
+            // Let the workers roam on all cores, unless told otherwise.
+            config.threadAttributes.coreAffinityMask_   = coreAffinityMask;
             // The worker's id will be appended to the thread's name.
             config.threadAttributes.name_               = "oqpi::worker_";
             // Set the worker's thread priority to a high value.
@@ -70,13 +99,13 @@ namespace oqpi {
             // Start as many workers as requested.
             config.count                                = workerCount;
 
-            scheduler_.template registerWorker<default_thread, default_semaphore, _WorkerContext>(config);
+            scheduler_.template registerWorker<default_thread, default_notifier, _WorkerContext>(config);
             // Fire it up!
             scheduler_.start();
         }
 
         //------------------------------------------------------------------------------------------
-        inline static void stop_scheduler()
+        inline void stop_scheduler()
         {
             scheduler_.stop();
         }
@@ -84,12 +113,12 @@ namespace oqpi {
 
         //------------------------------------------------------------------------------------------
         // Add a task to the scheduler
-        inline static task_handle schedule_task(const task_handle &hTask)
+        inline task_handle schedule_task(const task_handle &hTask)
         {
             return scheduler_.add(hTask);
         }
         //------------------------------------------------------------------------------------------
-        inline static task_handle schedule_task(task_handle &&hTask)
+        inline task_handle schedule_task(task_handle &&hTask)
         {
             return scheduler_.add(std::move(hTask));
         }
@@ -104,7 +133,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : user defined
         template<task_type _TaskType, typename _TaskContext, typename _Func, typename... _Args>
-        inline static task_handle schedule_task(const std::string &name, task_priority prio, _Func &&f, _Args &&...args)
+        inline task_handle schedule_task(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
         {
             auto spTask = self_type::make_task<_TaskType, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
             return self_type::schedule_task(std::move(spTask));
@@ -119,7 +148,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : user defined
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static task_handle schedule_task(const std::string &name, task_priority prio, _Func &&f, _Args &&...args)
+        inline task_handle schedule_task(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
         {
             return self_type::schedule_task<task_type::waitable, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
@@ -128,7 +157,7 @@ namespace oqpi {
         // Context  : default
         // Priority : user defined
         template<typename _Func, typename... _Args>
-        inline static task_handle schedule_task(const std::string &name, task_priority prio, _Func &&f, _Args &&...args)
+        inline task_handle schedule_task(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
         {
             return self_type::schedule_task<_DefaultTaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
@@ -137,7 +166,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : default
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static task_handle schedule_task(const std::string &name, _Func &&f, _Args &&...args)
+        inline task_handle schedule_task(const task_name &name, _Func &&f, _Args &&...args)
         {
             return self_type::schedule_task<_TaskContext>(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
@@ -146,28 +175,74 @@ namespace oqpi {
         // Context  : default
         // Priority : default
         template<typename _Func, typename... _Args>
-        inline static task_handle schedule_task(const std::string &name, _Func &&f, _Args &&...args)
+        inline task_handle schedule_task(const task_name &name, _Func &&f, _Args &&...args)
         {
             return self_type::schedule_task(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
         //------------------------------------------------------------------------------------------
 
 
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task, schedules it right away and returns a future on its result.
+        // The result can be taken out of the task without any copy, see task_future.
+        //
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Func, typename... _Args>
+        inline auto schedule_future(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            using return_type = decltype(spTask->takeResult());
+            scheduler_.add(task_handle(spTask));
+            return task_future<return_type>(std::move(spTask));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Func, typename... _Args>
+        inline auto schedule_future(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            return self_type::schedule_future<_DefaultTaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : default
+        template<typename _TaskContext, typename _Func, typename... _Args>
+        inline auto schedule_future(const task_name &name, _Func &&f, _Args &&...args)
+        {
+            return self_type::schedule_future<_TaskContext>(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : default
+        template<typename _Func, typename... _Args>
+        inline auto schedule_future(const task_name &name, _Func &&f, _Args &&...args)
+        {
+            return self_type::schedule_future(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
         //------------------------------------------------------------------------------------------
         // Type     : fire_and_forget
         // Context  : user defined
         // Priority : user defined
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static void fire_and_forget_task(const std::string &name, task_priority prio, _Func &&f, _Args &&...args)
+        inline void fire_and_forget_task(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
         {
-            self_type::schedule_task<task_type::fire_and_forget, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            auto spTask = self_type::make_task<task_type::fire_and_forget, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            scheduler_.post(task_handle(std::move(spTask)));
         }
         //------------------------------------------------------------------------------------------
         // Type     : fire_and_forget
         // Context  : default
         // Priority : user defined
         template<typename _Func, typename... _Args>
-        inline static void fire_and_forget_task(const std::string &name, task_priority prio, _Func &&f, _Args &&...args)
+        inline void fire_and_forget_task(const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
         {
             self_type::fire_and_forget_task<_DefaultTaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
@@ -176,7 +251,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : default
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static void fire_and_forget_task(const std::string &name, _Func &&f, _Args &&...args)
+        inline void fire_and_forget_task(const task_name &name, _Func &&f, _Args &&...args)
         {
             self_type::fire_and_forget_task<_TaskContext>(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
@@ -185,13 +260,184 @@ namespace oqpi {
         // Context  : default
         // Priority : default
         template<typename _Func, typename... _Args>
-        inline static void fire_and_forget_task(const std::string &name, _Func &&f, _Args &&...args)
+        inline void fire_and_forget_task(const task_name &name, _Func &&f, _Args &&...args)
         {
             self_type::fire_and_forget_task(name, default_priority, std::forward<_Func>(f), std::forward<_Args>(args)...);
         }
         //------------------------------------------------------------------------------------------
 
 
+        //------------------------------------------------------------------------------------------
+        // Add a task to the scheduler once the specified time is reached, the returned handle can
+        // be used to cancel it until then
+        inline timer_handle schedule_at(std::chrono::steady_clock::time_point time, const task_handle &hTask)
+        {
+            return scheduler_.addAt(time, hTask);
+        }
+        //------------------------------------------------------------------------------------------
+        // Add a task to the scheduler once the specified delay elapsed
+        template<typename _Rep, typename _Period>
+        inline timer_handle schedule_after(std::chrono::duration<_Rep, _Period> delay, const task_handle &hTask)
+        {
+            return scheduler_.addAfter(delay, hTask);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task and adds it to the scheduler once the specified time is reached,
+        // the task can be retrieved with timer_handle::getTask
+        //
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Func, typename... _Args>
+        inline timer_handle schedule_at(std::chrono::steady_clock::time_point time, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            return self_type::schedule_at(time, task_handle(std::move(spTask)));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Func, typename... _Args>
+        inline timer_handle schedule_at(std::chrono::steady_clock::time_point time, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            return self_type::schedule_at<_DefaultTaskContext>(time, name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task and adds it to the scheduler once the specified delay elapsed
+        //
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Rep, typename _Period, typename _Func, typename... _Args>
+        inline timer_handle schedule_after(std::chrono::duration<_Rep, _Period> delay, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            return self_type::schedule_after(delay, task_handle(std::move(spTask)));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Rep, typename _Period, typename _Func, typename... _Args>
+        inline timer_handle schedule_after(std::chrono::duration<_Rep, _Period> delay, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            return self_type::schedule_after<_DefaultTaskContext>(delay, name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Adds a new fire and forget task calling f to the scheduler every period, starting one
+        // period from now, until the returned handle is cancelled
+        //
+        // Type     : fire_and_forget
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Rep, typename _Period, typename _Func>
+        inline timer_handle schedule_every(std::chrono::duration<_Rep, _Period> period, const task_name &name, task_priority prio, _Func &&f)
+        {
+            // The name outlives this call, it has to be owned
+            return scheduler_.addPeriodic(period, [name = name.str(), prio, func = std::decay_t<_Func>(std::forward<_Func>(f))]()
+            {
+                return task_handle(self_type::make_task<task_type::fire_and_forget, _TaskContext>(name, prio, func));
+            });
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : fire_and_forget
+        // Context  : default
+        // Priority : user defined
+        template<typename _Rep, typename _Period, typename _Func>
+        inline timer_handle schedule_every(std::chrono::duration<_Rep, _Period> period, const task_name &name, task_priority prio, _Func &&f)
+        {
+            return self_type::schedule_every<_DefaultTaskContext>(period, name, prio, std::forward<_Func>(f));
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Continuations, nobody blocks waiting for the previous tasks: the task finishing last
+        // (or first for when_any) adds the next one to the scheduler
+        inline task_handle then(task_handle hTask, task_handle hNext)
+        {
+            return hTask.then(scheduler_, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename _Container>
+        inline task_handle when_all(const _Container &taskHandles, task_handle hNext)
+        {
+            return oqpi::when_all(scheduler_, taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+        inline task_handle when_all(std::initializer_list<task_handle> taskHandles, task_handle hNext)
+        {
+            return oqpi::when_all(scheduler_, taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename _Container>
+        inline task_handle when_any(const _Container &taskHandles, task_handle hNext)
+        {
+            return oqpi::when_any(scheduler_, taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+        inline task_handle when_any(std::initializer_list<task_handle> taskHandles, task_handle hNext)
+        {
+            return oqpi::when_any(scheduler_, taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task that is added to the scheduler once hTask is done
+        //
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Func, typename... _Args>
+        inline task_handle then(task_handle hTask, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _TaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            return self_type::then(std::move(hTask), task_handle(std::move(spTask)));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Func, typename... _Args>
+        inline task_handle then(task_handle hTask, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            return self_type::then<_DefaultTaskContext>(std::move(hTask), name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task that is added to the scheduler once every task is done
+        //
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Container, typename _Func, typename... _Args>
+        inline task_handle when_all(const _Container &taskHandles, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _DefaultTaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            return self_type::when_all(taskHandles, task_handle(std::move(spTask)));
+        }
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task that is added to the scheduler once any of the tasks is done
+        //
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Container, typename _Func, typename... _Args>
+        inline task_handle when_any(const _Container &taskHandles, const task_name &name, task_priority prio, _Func &&f, _Args &&...args)
+        {
+            auto spTask = self_type::make_task<task_type::waitable, _DefaultTaskContext>(name, prio, std::forward<_Func>(f), std::forward<_Args>(args)...);
+            return self_type::when_any(taskHandles, task_handle(std::move(spTask)));
+        }
+        //------------------------------------------------------------------------------------------
+
+
 
 
         //------------------------------------------------------------------------------------------
@@ -201,16 +447,16 @@ namespace oqpi {
         // Context  : user defined
         // Priority : user defined
         template<task_type _TaskType, typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
-            return oqpi::make_task<_TaskType, _EventType, _TaskContext>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
+            return oqpi::allocate_task<_TaskType, _EventType, _TaskContext>(_Allocator(), name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
         //------------------------------------------------------------------------------------------
         // Type     : user defined
         // Context  : default
         // Priority : user defined
         template<task_type _TaskType, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<_TaskType, _DefaultTaskContext>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -219,7 +465,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : default
         template<task_type _TaskType, typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<_TaskType, _TaskContext>(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -228,7 +474,7 @@ namespace oqpi {
         // Context  : default
         // Priority : default
         template<task_type _TaskType, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<_TaskType>(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -242,7 +488,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : user defined
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<task_type::waitable, _TaskContext>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -251,7 +497,7 @@ namespace oqpi {
         // Context  : default
         // Priority : user defined
         template<typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<_DefaultTaskContext>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -260,7 +506,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : default
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<_TaskContext>(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -269,7 +515,7 @@ namespace oqpi {
         // Context  : default
         // Priority : default
         template<typename _Func, typename... _Args>
-        inline static auto make_task(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -283,7 +529,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : user defined
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task_item(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task_item(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
             return self_type::make_task<task_type::fire_and_forget, _TaskContext, _Func>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -292,7 +538,7 @@ namespace oqpi {
         // Context  : default
         // Priority : user defined
         template<typename _Func, typename... _Args>
-        inline static auto make_task_item(const std::string &name, task_priority priority, _Func &&func, _Args &&...args)
+        inline static auto make_task_item(const task_name &name, task_priority priority, _Func &&func, _Args &&...args)
         {
             return self_type::make_task_item<_DefaultTaskContext>(name, priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -301,7 +547,7 @@ namespace oqpi {
         // Context  : user defined
         // Priority : default
         template<typename _TaskContext, typename _Func, typename... _Args>
-        inline static auto make_task_item(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task_item(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task_item<_TaskContext, _Func>(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
@@ -310,13 +556,73 @@ namespace oqpi {
         // Context  : default
         // Priority : default
         template<typename _Func, typename... _Args>
-        inline static auto make_task_item(const std::string &name, _Func &&func, _Args &&...args)
+        inline static auto make_task_item(const task_name &name, _Func &&func, _Args &&...args)
         {
             return self_type::make_task_item(name, default_priority, std::forward<_Func>(func), std::forward<_Args>(args)...);
         }
         //------------------------------------------------------------------------------------------
 
 
+#if OQPI_HAS_COROUTINES
+        //------------------------------------------------------------------------------------------
+        // Creates a task running a coroutine, the task is NOT added to the scheduler, see co_task
+        //
+        // Type     : user defined
+        // Context  : user defined
+        // Priority : user defined
+        template<task_type _TaskType, typename _TaskContext, typename _Result>
+        inline auto make_coroutine_task(const task_name &name, task_priority prio, co_task<_Result> coroutine)
+        {
+            return oqpi::allocate_coroutine_task<_TaskType, _EventType, _TaskContext>(_Allocator(), scheduler_, name, prio, std::move(coroutine));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : user defined
+        // Context  : default
+        // Priority : user defined
+        template<task_type _TaskType, typename _Result>
+        inline auto make_coroutine_task(const task_name &name, task_priority prio, co_task<_Result> coroutine)
+        {
+            return self_type::make_coroutine_task<_TaskType, _DefaultTaskContext>(name, prio, std::move(coroutine));
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        // Creates a waitable task running a coroutine and schedules it right away. The returned
+        // task gives the result of the coroutine.
+        //
+        // Type     : waitable
+        // Context  : user defined
+        // Priority : user defined
+        template<typename _TaskContext, typename _Result>
+        inline auto schedule_coroutine(const task_name &name, task_priority prio, co_task<_Result> coroutine)
+        {
+            auto spTask = self_type::make_coroutine_task<task_type::waitable, _TaskContext>(name, prio, std::move(coroutine));
+            scheduler_.add(task_handle(spTask));
+            return spTask;
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : user defined
+        template<typename _Result>
+        inline auto schedule_coroutine(const task_name &name, task_priority prio, co_task<_Result> coroutine)
+        {
+            return self_type::schedule_coroutine<_DefaultTaskContext>(name, prio, std::move(coroutine));
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : waitable
+        // Context  : default
+        // Priority : default
+        template<typename _Result>
+        inline auto schedule_coroutine(const task_name &name, co_task<_Result> coroutine)
+        {
+            return self_type::schedule_coroutine(name, default_priority, std::move(coroutine));
+        }
+        //------------------------------------------------------------------------------------------
+#endif
+
+
 
         
         //------------------------------------------------------------------------------------------
@@ -325,36 +631,57 @@ namespace oqpi {
         // Type     : user defined
         // Context  : user defined
         template<task_type _TaskType, typename _GroupContext>
-        inline static auto make_parallel_group(const std::string &name, task_priority prio = default_priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
+        inline auto make_parallel_group(const task_name &name, task_priority prio = default_priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
         {
-            return oqpi::make_parallel_group<_TaskType, _GroupContext>(scheduler_, name, prio, taskCount, maxSimultaneousTasks);
+            return oqpi::allocate_task_group<parallel_group, _TaskType, _GroupContext>(_Allocator(), scheduler_, name, prio, taskCount, maxSimultaneousTasks);
         }
         //------------------------------------------------------------------------------------------
         // Type     : user defined
         // Context  : default
         template<task_type _TaskType>
-        inline static auto make_parallel_group(const std::string &name, task_priority prio = default_priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
+        inline auto make_parallel_group(const task_name &name, task_priority prio = default_priority, int32_t taskCount = 0, int32_t maxSimultaneousTasks = 0)
         {
             return self_type::make_parallel_group<_TaskType, _DefaultGroupContext>(name, prio, taskCount, maxSimultaneousTasks);
         }
         //------------------------------------------------------------------------------------------
 
 
+        //------------------------------------------------------------------------------------------
+        // Create a graph of tasks, the graph is NOT added to the scheduler
+        //
+        // Type     : user defined
+        // Context  : user defined
+        template<task_type _TaskType, typename _GroupContext>
+        inline auto make_task_graph(const task_name &name, task_priority prio = default_priority, int32_t nodeCount = 0)
+        {
+            return oqpi::allocate_task_group<task_graph, _TaskType, _GroupContext>(_Allocator(), scheduler_, name, prio, nodeCount);
+        }
+        //------------------------------------------------------------------------------------------
+        // Type     : user defined
+        // Context  : default
+        template<task_type _TaskType>
+        inline auto make_task_graph(const task_name &name, task_priority prio = default_priority, int32_t nodeCount = 0)
+        {
+            return self_type::make_task_graph<_TaskType, _DefaultGroupContext>(name, prio, nodeCount);
+        }
+        //------------------------------------------------------------------------------------------
+
+
         //------------------------------------------------------------------------------------------
         // Creates a sequence of tasks, the group is NOT added to the scheduler
         //
         // Type     : user defined
         // Context  : user defined
         template<task_type _TaskType, typename _GroupContext>
-        inline static auto make_sequence_group(const std::string &name, task_priority prio = default_priority)
+        inline auto make_sequence_group(const task_name &name, task_priority prio = default_priority)
         {
-            return oqpi::make_sequence_group<_TaskType, _GroupContext>(scheduler_, name, prio);
+            return oqpi::allocate_task_group<sequence_group, _TaskType, _GroupContext>(_Allocator(), scheduler_, name, prio);
         }
         //------------------------------------------------------------------------------------------
         // Type     : user defined
         // Context  : default
         template<task_type _TaskType>
-        inline static auto make_sequence_group(const std::string &name, task_priority prio = default_priority)
+        inline auto make_sequence_group(const task_name &name, task_priority prio = default_priority)
         {
             return self_type::make_sequence_group<_TaskType, _DefaultGroupContext>(name, prio);
         }
@@ -365,15 +692,15 @@ namespace oqpi {
         // Group Context    : user defined
         // Task Context     : user defined
         template<task_type _TaskType, typename _GroupContext, typename _TaskContext, typename _Func, typename _Partitioner>
-        inline static auto make_parallel_for_task_group(const std::string &name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline auto make_parallel_for_task_group(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
-            return oqpi::make_parallel_for_task_group<_TaskType, _EventType, _GroupContext, _TaskContext>(scheduler_, name, partitioner, prio, std::forward<_Func>(func));
+            return oqpi::allocate_parallel_for_task_group<_TaskType, _EventType, _GroupContext, _TaskContext>(_Allocator(), scheduler_, name, partitioner, prio, std::forward<_Func>(func));
         }
         //------------------------------------------------------------------------------------------
         // Group Context    : default
         // Task Context     : default
         template<task_type _TaskType, typename _Func, typename _Partitioner>
-        inline static auto make_parallel_for_task_group(const std::string &name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline auto make_parallel_for_task_group(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
             return self_type::make_parallel_for_task_group<_TaskType, _DefaultGroupContext, _DefaultTaskContext>(name, partitioner, prio, std::forward<_Func>(func));
         }
@@ -386,9 +713,9 @@ namespace oqpi {
         // Partitioner      : user defined
         // Priority         : user defined
         template<typename _GroupContext, typename _TaskContext, typename _Func, typename _Partitioner>
-        inline static void parallel_for(const std::string &name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline void parallel_for(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
-            oqpi::parallel_for<_EventType, _GroupContext, _TaskContext>(scheduler_, name, partitioner, prio, std::forward<_Func>(func));
+            oqpi::allocate_parallel_for<_EventType, _GroupContext, _TaskContext>(_Allocator(), scheduler_, name, partitioner, prio, std::forward<_Func>(func));
         }
         //------------------------------------------------------------------------------------------
         // Group Context    : user defined
@@ -396,7 +723,7 @@ namespace oqpi {
         // Partitioner      : simple_partitioner
         // Priority         : normal
         template<typename _GroupContext, typename _TaskContext, typename _Func>
-        inline static void parallel_for(const std::string &name, int32_t firstIndex, int32_t lastIndex, _Func &&func)
+        inline void parallel_for(std::string_view name, int32_t firstIndex, int32_t lastIndex, _Func &&func)
         {
             const auto priority     = default_priority;
             const auto partitioner  = oqpi::simple_partitioner(firstIndex, lastIndex, scheduler_.workersCount(priority));
@@ -408,7 +735,7 @@ namespace oqpi {
         // Partitioner      : simple_partitioner
         // Priority         : normal
         template<typename _GroupContext, typename _TaskContext, typename _Func>
-        inline static void parallel_for(const std::string &name, int32_t elementCount, _Func &&func)
+        inline void parallel_for(std::string_view name, int32_t elementCount, _Func &&func)
         {
             self_type::parallel_for<_GroupContext, _TaskContext>(name, 0, elementCount, std::forward<_Func>(func));
         }
@@ -418,7 +745,7 @@ namespace oqpi {
         // Partitioner      : user defined
         // Priority         : user defined
         template<typename _Func, typename _Partitioner>
-        inline static void parallel_for(const std::string &name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline void parallel_for(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
             self_type::parallel_for<_DefaultGroupContext, _DefaultTaskContext>(name, partitioner, prio, std::forward<_Func>(func));
         }
@@ -428,7 +755,7 @@ namespace oqpi {
         // Partitioner      : simple_partitioner
         // Priority         : normal
         template<typename _Func>
-        inline static void parallel_for(const std::string &name, int32_t firstIndex, int32_t lastIndex, _Func &&func)
+        inline void parallel_for(std::string_view name, int32_t firstIndex, int32_t lastIndex, _Func &&func)
         {
             self_type::parallel_for<_DefaultGroupContext, _DefaultTaskContext>(name, firstIndex, lastIndex, std::forward<_Func>(func));
         }
@@ -438,20 +765,63 @@ namespace oqpi {
         // Partitioner      : simple_partitioner
         // Priority         : normal
         template<typename _Func>
-        inline static void parallel_for(const std::string &name, int32_t elementCount, _Func &&func)
+        inline void parallel_for(std::string_view name, int32_t elementCount, _Func &&func)
         {
             self_type::parallel_for(name, 0, elementCount, std::forward<_Func>(func));
         }
         //------------------------------------------------------------------------------------------
 
 
+        //------------------------------------------------------------------------------------------
+        // Same as parallel_for but the loop is only scheduled, the returned handle can be waited
+        // for or awaited from a co_task. Invalid if there's nothing to loop over.
+        //
+        // Group Context    : user defined
+        // Task Context     : user defined
+        // Partitioner      : user defined
+        // Priority         : user defined
+        template<typename _GroupContext, typename _TaskContext, typename _Func, typename _Partitioner>
+        inline task_handle schedule_parallel_for(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        {
+            auto spTaskGroup = self_type::make_parallel_for_task_group<task_type::waitable, _GroupContext, _TaskContext>(name, partitioner, prio, std::forward<_Func>(func));
+            if (!spTaskGroup)
+            {
+                return task_handle();
+            }
+            return self_type::schedule_task(task_handle(std::move(spTaskGroup)));
+        }
+        //------------------------------------------------------------------------------------------
+        // Group Context    : default
+        // Task Context     : default
+        // Partitioner      : user defined
+        // Priority         : user defined
+        template<typename _Func, typename _Partitioner>
+        inline task_handle schedule_parallel_for(std::string_view name, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        {
+            return self_type::schedule_parallel_for<_DefaultGroupContext, _DefaultTaskContext>(name, partitioner, prio, std::forward<_Func>(func));
+        }
+        //------------------------------------------------------------------------------------------
+        // Group Context    : default
+        // Task Context     : default
+        // Partitioner      : simple_partitioner
+        // Priority         : normal
+        template<typename _Func>
+        inline task_handle schedule_parallel_for(std::string_view name, int32_t elementCount, _Func &&func)
+        {
+            const auto priority     = default_priority;
+            const auto partitioner  = oqpi::simple_partitioner(0, elementCount, scheduler_.workersCount(priority));
+            return self_type::schedule_parallel_for(name, partitioner, priority, std::forward<_Func>(func));
+        }
+        //------------------------------------------------------------------------------------------
+
+
         //------------------------------------------------------------------------------------------
         // Group Context    : user defined
         // Task Context     : user defined
         // Partitioner      : user defined
         // Priority         : user defined
         template<typename _GroupContext, typename _TaskContext, typename _Func, typename _Container, typename _Partitioner>
-        inline static void parallel_for_each(const std::string &name, _Container &container, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline void parallel_for_each(std::string_view name, _Container &container, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
             self_type::parallel_for<_GroupContext, _TaskContext>(name, partitioner, prio,
                 [&container, func = std::forward<_Func>(func)](int32_t elementIndex)
@@ -465,7 +835,7 @@ namespace oqpi {
         // Partitioner      : user defined
         // Priority         : user defined
         template<typename _Func, typename _Container, typename _Partitioner>
-        inline static void parallel_for_each(const std::string &name, _Container &container, const _Partitioner &partitioner, task_priority prio, _Func &&func)
+        inline void parallel_for_each(std::string_view name, _Container &container, const _Partitioner &partitioner, task_priority prio, _Func &&func)
         {
             self_type::parallel_for_each<_DefaultGroupContext, _DefaultTaskContext>(name, container, partitioner, prio, std::forward<_Func>(func));
         }
@@ -475,7 +845,7 @@ namespace oqpi {
         // Partitioner      : simple_partitioner
         // Priority         : normal
         template<typename _Func, typename _Container>
-        inline static void parallel_for_each(const std::string &name, _Container &container, _Func &&func)
+        inline void parallel_for_each(std::string_view name, _Container &container, _Func &&func)
         {
             self_type::parallel_for(name, 0, int32_t(container.size()),
                 [&container, func = std::forward<_Func>(func)](int32_t elementIndex)
@@ -492,7 +862,7 @@ namespace oqpi {
         // Group Context    : user defined
         // Priority         : user defined
         template<task_type _TaskType, typename _GroupContext, typename... _TaskHandles>
-        inline static auto sequence_tasks(const std::string &name, task_priority prio, _TaskHandles &&...taskHandles)
+        inline auto sequence_tasks(const task_name &name, task_priority prio, _TaskHandles &&...taskHandles)
         {
             auto spSequence = self_type::make_sequence_group<_TaskType, _GroupContext>(name, prio);
             self_type::add_to_group(spSequence, std::forward<_TaskHandles>(taskHandles)...);
@@ -502,7 +872,7 @@ namespace oqpi {
         // Group Context    : default
         // Priority         : user defined
         template<task_type _TaskType, typename... _TaskHandles>
-        inline static auto sequence_tasks(const std::string &name, task_priority prio, _TaskHandles &&...taskHandles)
+        inline auto sequence_tasks(const task_name &name, task_priority prio, _TaskHandles &&...taskHandles)
         {
             return self_type::sequence_tasks<_TaskType, _DefaultGroupContext>(name, prio, std::forward<_TaskHandles>(taskHandles)...);
         }
@@ -510,7 +880,7 @@ namespace oqpi {
         // Group Context    : user defined
         // Priority         : default
         template<task_type _TaskType, typename _GroupContext, typename... _TaskHandles>
-        inline static auto sequence_tasks(const std::string &name, _TaskHandles &&...taskHandles)
+        inline auto sequence_tasks(const task_name &name, _TaskHandles &&...taskHandles)
         {
             return self_type::sequence_tasks<_TaskType, _GroupContext>(name, default_priority, std::forward<_TaskHandles>(taskHandles)...);
         }
@@ -518,7 +888,7 @@ namespace oqpi {
         // Group Context    : default
         // Priority         : default
         template<task_type _TaskType, typename... _TaskHandles>
-        inline static auto sequence_tasks(const std::string &name, _TaskHandles &&...taskHandles)
+        inline auto sequence_tasks(const task_name &name, _TaskHandles &&...taskHandles)
         {
             return self_type::sequence_tasks<_TaskType>(name, default_priority, std::forward<_TaskHandles>(taskHandles)...);
         }
@@ -531,7 +901,7 @@ namespace oqpi {
         // Group Context    : user defined
         // Priority         : user defined
         template<task_type _TaskType, typename _GroupContext, typename... _TaskHandles>
-        inline static auto fork_tasks(const std::string &name, task_priority prio, _TaskHandles &&...taskHandles)
+        inline auto fork_tasks(const task_name &name, task_priority prio, _TaskHandles &&...taskHandles)
         {
             auto spFork = self_type::make_parallel_group<_TaskType, _GroupContext>(name, prio, sizeof...(taskHandles));
             self_type::add_to_group(spFork, std::forward<_TaskHandles>(taskHandles)...);
@@ -541,7 +911,7 @@ namespace oqpi {
         // Group Context    : default
         // Priority         : user defined
         template<task_type _TaskType, typename... _TaskHandles>
-        inline static auto fork_tasks(const std::string &name, task_priority prio, _TaskHandles &&...taskHandles)
+        inline auto fork_tasks(const task_name &name, task_priority prio, _TaskHandles &&...taskHandles)
         {
             return self_type::fork_tasks<_TaskType, _DefaultGroupContext>(name, prio, std::forward<_TaskHandles>(taskHandles)...);
         }
@@ -549,7 +919,7 @@ namespace oqpi {
         // Group Context    : default
         // Priority         : default
         template<task_type _TaskType, typename... _TaskHandles>
-        inline static auto fork_tasks(const std::string &name, _TaskHandles &&...taskHandles)
+        inline auto fork_tasks(const task_name &name, _TaskHandles &&...taskHandles)
         {
             return self_type::fork_tasks<_TaskType, _DefaultGroupContext>(name, default_priority, std::forward<_TaskHandles>(taskHandles)...);
         }
@@ -571,11 +941,266 @@ namespace oqpi {
         {
             spGroup->addTask(std::forward<task_handle>(taskHandle));
         }
+
+    private:
+        _Scheduler scheduler_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Static toolkit, one per set of template arguments, usable from anywhere without passing it
+    // around. Each function forwards to the toolkit of the same name, see toolkit for the details
+    // of their overloads.
+    //
+    template
+    <
+          typename _Scheduler           = scheduler<concurrent_queue>
+        , typename _DefaultGroupContext = empty_group_context
+        , typename _DefaultTaskContext  = empty_task_context
+        , typename _EventType           = manual_reset_event_interface<>
+        , typename _Allocator           = std::allocator<char>
+    >
+    struct helpers
+    {
+        //------------------------------------------------------------------------------------------
+        using toolkit_type = toolkit<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType, _Allocator>;
+
+        //------------------------------------------------------------------------------------------
+        using default_thread = typename toolkit_type::default_thread;
+
+        //------------------------------------------------------------------------------------------
+        static constexpr auto default_priority = toolkit_type::default_priority;
+
+
+        //------------------------------------------------------------------------------------------
+        // Static instance
+        static toolkit_type toolkit_;
+        static toolkit_type& instance() { return toolkit_; }
+        static _Scheduler& scheduler() { return toolkit_.scheduler(); }
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) start_default_scheduler(_Args &&...args)
+        {
+            return toolkit_.template start_default_scheduler<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        inline static void stop_scheduler()
+        {
+            toolkit_.stop_scheduler();
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_task(_Args &&...args)
+        {
+            // Without template arguments the handle only overloads are candidates too
+            if constexpr (sizeof...(_Types) == 0)
+            {
+                return toolkit_.schedule_task(std::forward<_Args>(args)...);
+            }
+            else
+            {
+                return toolkit_.template schedule_task<_Types...>(std::forward<_Args>(args)...);
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_task(_Args &&...args)
+        {
+            return toolkit_.template schedule_task<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_future(_Args &&...args)
+        {
+            return toolkit_.template schedule_future<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) fire_and_forget_task(_Args &&...args)
+        {
+            return toolkit_.template fire_and_forget_task<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_at(_Args &&...args)
+        {
+            // Without template arguments the handle only overloads are candidates too
+            if constexpr (sizeof...(_Types) == 0)
+            {
+                return toolkit_.schedule_at(std::forward<_Args>(args)...);
+            }
+            else
+            {
+                return toolkit_.template schedule_at<_Types...>(std::forward<_Args>(args)...);
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_after(_Args &&...args)
+        {
+            return toolkit_.template schedule_after<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_every(_Args &&...args)
+        {
+            return toolkit_.template schedule_every<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) then(_Args &&...args)
+        {
+            // Without template arguments the handle only overloads are candidates too
+            if constexpr (sizeof...(_Types) == 0)
+            {
+                return toolkit_.then(std::forward<_Args>(args)...);
+            }
+            else
+            {
+                return toolkit_.template then<_Types...>(std::forward<_Args>(args)...);
+            }
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) when_all(_Args &&...args)
+        {
+            return toolkit_.template when_all<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        inline static task_handle when_all(std::initializer_list<task_handle> taskHandles, task_handle hNext)
+        {
+            return toolkit_.when_all(taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) when_any(_Args &&...args)
+        {
+            return toolkit_.template when_any<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        inline static task_handle when_any(std::initializer_list<task_handle> taskHandles, task_handle hNext)
+        {
+            return toolkit_.when_any(taskHandles, std::move(hNext));
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) make_task(_Args &&...args)
+        {
+            return toolkit_.template make_task<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_task(_Args &&...args)
+        {
+            return toolkit_.template make_task<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) make_task_item(_Args &&...args)
+        {
+            return toolkit_.template make_task_item<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+#if OQPI_HAS_COROUTINES
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_coroutine_task(_Args &&...args)
+        {
+            return toolkit_.template make_coroutine_task<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_coroutine(_Args &&...args)
+        {
+            return toolkit_.template schedule_coroutine<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+#endif
+
+
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_parallel_group(_Args &&...args)
+        {
+            return toolkit_.template make_parallel_group<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_task_graph(_Args &&...args)
+        {
+            return toolkit_.template make_task_graph<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_sequence_group(_Args &&...args)
+        {
+            return toolkit_.template make_sequence_group<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) make_parallel_for_task_group(_Args &&...args)
+        {
+            return toolkit_.template make_parallel_for_task_group<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) parallel_for(_Args &&...args)
+        {
+            return toolkit_.template parallel_for<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) schedule_parallel_for(_Args &&...args)
+        {
+            return toolkit_.template schedule_parallel_for<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<typename... _Types, typename... _Args>
+        inline static decltype(auto) parallel_for_each(_Args &&...args)
+        {
+            return toolkit_.template parallel_for_each<_Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+
+
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) sequence_tasks(_Args &&...args)
+        {
+            return toolkit_.template sequence_tasks<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
+        template<task_type _TaskType, typename... _Types, typename... _Args>
+        inline static decltype(auto) fork_tasks(_Args &&...args)
+        {
+            return toolkit_.template fork_tasks<_TaskType, _Types...>(std::forward<_Args>(args)...);
+        }
+        //------------------------------------------------------------------------------------------
     };
 
     //----------------------------------------------------------------------------------------------
-    template<typename _Scheduler, typename _DefaultGroupContext, typename _DefaultTaskContext, typename _EventType>
-    _Scheduler helpers<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType>::scheduler_;
+    template<typename _Scheduler, typename _DefaultGroupContext, typename _DefaultTaskContext, typename _EventType, typename _Allocator>
+    typename helpers<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType, _Allocator>::toolkit_type helpers<_Scheduler, _DefaultGroupContext, _DefaultTaskContext, _EventType, _Allocator>::toolkit_;
     //----------------------------------------------------------------------------------------------
 
 
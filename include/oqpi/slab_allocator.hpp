@@ -0,0 +1,274 @@
+#pragma once
+
+#include <new>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+#include "oqpi/error_handling.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Pool of fixed size blocks for the small objects that are allocated and freed at a high rate,
+    // typically tasks and groups along with their shared_ptr control block.
+    //
+    // Each thread allocates from its own heap, made of slabs carved into blocks of a few size
+    // classes (64 to 1024 bytes). A block freed by the thread owning its heap goes back to the
+    // local free list without any synchronization. A block freed by any other thread, which is
+    // what happens when a worker releases a task created by another thread, is pushed to a lock
+    // free remote list of the owning heap. The owner takes the whole remote list at once when its
+    // local list runs dry.
+    //
+    // Slabs are aligned on their size so that the heap owning a block is found by masking its
+    // address. They are never given back to the system: the heap of a thread that exits is kept
+    // with its slabs and adopted by the next thread needing one.
+    // Bigger or over aligned allocations fall back to the global operator new.
+    //
+    class slab_pool
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        static constexpr size_t size_class_count    = 5;
+        static constexpr size_t min_block_size      = 64;
+        static constexpr size_t max_block_size      = min_block_size << (size_class_count - 1);
+        static constexpr size_t slab_size           = 64 * 1024;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        static void* allocate(size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            if (size > max_block_size || alignment > min_block_size)
+            {
+                return ::operator new(size, std::align_val_t(alignment));
+            }
+
+            auto &sizeClass = this_thread_heap()->sizeClasses[size_class_index(size)];
+
+            // Local list first, then whatever was freed by other threads, then a fresh block
+            if (sizeClass.pLocalFree == nullptr)
+            {
+                sizeClass.pLocalFree = sizeClass.pRemoteFree.exchange(nullptr, std::memory_order_acquire);
+            }
+
+            if (auto pBlock = sizeClass.pLocalFree)
+            {
+                sizeClass.pLocalFree = pBlock->pNext;
+                return pBlock;
+            }
+
+            const auto blockSize = min_block_size << size_class_index(size);
+            if (sizeClass.pBump == sizeClass.pBumpEnd)
+            {
+                newSlab(sizeClass, size_class_index(size));
+            }
+            auto pBlock = sizeClass.pBump;
+            sizeClass.pBump += blockSize;
+            return pBlock;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // size and alignment have to be the ones passed to allocate
+        static void deallocate(void *p, size_t size, size_t alignment = alignof(std::max_align_t))
+        {
+            if (p == nullptr)
+            {
+                return;
+            }
+
+            if (size > max_block_size || alignment > min_block_size)
+            {
+                ::operator delete(p, std::align_val_t(alignment));
+                return;
+            }
+
+            const auto pSlab = reinterpret_cast<slab_header*>(reinterpret_cast<uintptr_t>(p) & ~uintptr_t(slab_size - 1));
+            oqpi_checkf(pSlab->sizeClassIndex == size_class_index(size), "Block freed with the wrong size: %d", int32_t(size));
+
+            auto &sizeClass = pSlab->pOwner->sizeClasses[pSlab->sizeClassIndex];
+            auto pBlock     = static_cast<free_block*>(p);
+            if (pSlab->pOwner == this_thread_heap_ptr())
+            {
+                pBlock->pNext           = sizeClass.pLocalFree;
+                sizeClass.pLocalFree    = pBlock;
+            }
+            else
+            {
+                pBlock->pNext = sizeClass.pRemoteFree.load(std::memory_order_relaxed);
+                while (!sizeClass.pRemoteFree.compare_exchange_weak(pBlock->pNext, pBlock, std::memory_order_release, std::memory_order_relaxed));
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct free_block
+        {
+            free_block *pNext;
+        };
+
+        struct size_class
+        {
+            // Only touched by the owner
+            free_block                 *pLocalFree  = nullptr;
+            char                       *pBump       = nullptr;
+            char                       *pBumpEnd    = nullptr;
+            // Blocks freed by the other threads
+            alignas(64) std::atomic<free_block*> pRemoteFree{ nullptr };
+        };
+
+        struct heap
+        {
+            size_class  sizeClasses[size_class_count];
+            // Next heap waiting to be adopted
+            heap       *pNextOrphan = nullptr;
+        };
+
+        // Sits at the beginning of each slab, the first block starts right after
+        struct slab_header
+        {
+            heap       *pOwner;
+            size_t      sizeClassIndex;
+        };
+        static_assert(sizeof(slab_header) <= min_block_size, "The slab header has to fit in the first block.");
+
+        //------------------------------------------------------------------------------------------
+        // Gives the heap back to the pool when the thread exits
+        struct heap_owner
+        {
+            ~heap_owner()
+            {
+                if (pHeap)
+                {
+                    this_thread_heap_ptr() = nullptr;
+                    release_heap(pHeap);
+                }
+            }
+
+            heap *pHeap = nullptr;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static size_t size_class_index(size_t size)
+        {
+            size_t index = 0;
+            while ((min_block_size << index) < size)
+            {
+                ++index;
+            }
+            return index;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static heap*& this_thread_heap_ptr()
+        {
+            static thread_local heap *pHeap = nullptr;
+            return pHeap;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static heap* this_thread_heap()
+        {
+            auto &pHeap = this_thread_heap_ptr();
+            if (pHeap == nullptr)
+            {
+                static thread_local heap_owner owner;
+                owner.pHeap = acquire_heap();
+                pHeap       = owner.pHeap;
+            }
+            return pHeap;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void newSlab(size_class &sizeClass, size_t sizeClassIndex)
+        {
+            auto pSlab = static_cast<char*>(::operator new(slab_size, std::align_val_t(slab_size)));
+            new (pSlab) slab_header{ this_thread_heap_ptr(), sizeClassIndex };
+            sizeClass.pBump     = pSlab + min_block_size;
+            // Drop the tail that can't hold a whole block
+            const auto blockSize = min_block_size << sizeClassIndex;
+            sizeClass.pBumpEnd  = sizeClass.pBump + ((slab_size - min_block_size) / blockSize) * blockSize;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static heap* acquire_heap()
+        {
+            {
+                std::lock_guard<std::mutex> __l(orphans_mutex());
+                if (auto pHeap = orphans())
+                {
+                    orphans() = pHeap->pNextOrphan;
+                    pHeap->pNextOrphan = nullptr;
+                    return pHeap;
+                }
+            }
+            return new heap;
+        }
+
+        //------------------------------------------------------------------------------------------
+        static void release_heap(heap *pHeap)
+        {
+            std::lock_guard<std::mutex> __l(orphans_mutex());
+            pHeap->pNextOrphan = orphans();
+            orphans() = pHeap;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Heaps of the threads that exited, never freed
+        static heap*& orphans()
+        {
+            static heap *pOrphans = nullptr;
+            return pOrphans;
+        }
+
+        static std::mutex& orphans_mutex()
+        {
+            static std::mutex *pMutex = new std::mutex;
+            return *pMutex;
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+
+
+    //----------------------------------------------------------------------------------------------
+    // Standard allocator on top of the slab pool, meant for std::allocate_shared so that the
+    // object and its control block end up in a single block
+    template<typename T>
+    class slab_allocator
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using value_type = T;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        slab_allocator() noexcept = default;
+
+        template<typename U>
+        slab_allocator(const slab_allocator<U> &) noexcept
+        {}
+
+    public:
+        //------------------------------------------------------------------------------------------
+        T* allocate(size_t n)
+        {
+            return static_cast<T*>(slab_pool::allocate(n * sizeof(T), alignof(T)));
+        }
+
+        //------------------------------------------------------------------------------------------
+        void deallocate(T *p, size_t n) noexcept
+        {
+            slab_pool::deallocate(p, n * sizeof(T), alignof(T));
+        }
+    };
+    //----------------------------------------------------------------------------------------------
+    template<typename T, typename U>
+    inline bool operator ==(const slab_allocator<T> &, const slab_allocator<U> &) { return true; }
+    template<typename T, typename U>
+    inline bool operator !=(const slab_allocator<T> &, const slab_allocator<U> &) { return false; }
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
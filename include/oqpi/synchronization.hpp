@@ -3,5 +3,6 @@
 #include "oqpi/synchronization/sync.hpp"
 #include "oqpi/synchronization/event.hpp"
 #include "oqpi/synchronization/mutex.hpp"
+#include "oqpi/synchronization/notifier.hpp"
 #include "oqpi/synchronization/semaphore.hpp"
 //#include "oqpi/synchronization/reader_writer_lock.hpp"
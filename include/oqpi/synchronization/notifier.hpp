@@ -0,0 +1,23 @@
+#pragma once
+
+#include "oqpi/platform.hpp"
+#include "oqpi/synchronization/semaphore.hpp"
+
+#if defined(__linux__)
+#	include "oqpi/synchronization/posix/linux_futex_notifier.hpp"
+#endif
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Notifier used by default to put workers to sleep and wake them up.
+    // On Linux it's a futex word, only going through the kernel when the worker is actually
+    // sleeping. Elsewhere it's a semaphore.
+#if defined(__linux__)
+    using default_notifier = futex_notifier;
+#else
+    using default_notifier = semaphore_interface<>;
+#endif
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
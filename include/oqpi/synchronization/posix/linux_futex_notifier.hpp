@@ -0,0 +1,142 @@
+#pragma once
+
+#include <ctime>
+#include <chrono>
+#include <atomic>
+#include <cstdint>
+
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Binary notifier for a single waiter built on a futex word.
+    // The word is either empty, notified or parked (the waiter is sleeping on the futex).
+    // Notifying only goes through the kernel when the waiter is parked, and consuming a pending
+    // notification is a single atomic exchange.
+    // Several notifications sent before the waiter consumes them collapse into one: the waiter is
+    // expected to check for work until there's none left before waiting again.
+    //
+    class futex_notifier
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        futex_notifier()
+            : state_(empty)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        futex_notifier(const futex_notifier &)              = delete;
+        futex_notifier& operator =(const futex_notifier &)  = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        void notifyOne()
+        {
+            if (state_.exchange(notified, std::memory_order_acq_rel) == parked)
+            {
+                futex(FUTEX_WAKE_PRIVATE, 1, nullptr);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Consumes the pending notification if any, waiter only
+        bool tryWait()
+        {
+            return state_.exchange(empty, std::memory_order_acquire) == notified;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Discards any pending notification, waiter only
+        void reset()
+        {
+            state_.store(empty, std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Blocks until notified, waiter only
+        bool wait()
+        {
+            auto s = state_.load(std::memory_order_acquire);
+            while (true)
+            {
+                if (s == notified)
+                {
+                    if (state_.compare_exchange_weak(s, empty, std::memory_order_acquire))
+                    {
+                        return true;
+                    }
+                }
+                else if (s == parked || state_.compare_exchange_weak(s, parked, std::memory_order_relaxed))
+                {
+                    // Returns right away if the word is not parked anymore
+                    futex(FUTEX_WAIT_PRIVATE, parked, nullptr);
+                    s = state_.load(std::memory_order_acquire);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Blocks until notified or until relTime elapsed, waiter only.
+        // Returns false in case of a time out.
+        template<typename _Rep, typename _Period>
+        bool waitFor(const std::chrono::duration<_Rep, _Period> &relTime)
+        {
+            const auto deadline = std::chrono::steady_clock::now() + relTime;
+            auto s = state_.load(std::memory_order_acquire);
+            while (true)
+            {
+                if (s == notified)
+                {
+                    if (state_.compare_exchange_weak(s, empty, std::memory_order_acquire))
+                    {
+                        return true;
+                    }
+                }
+                else if (s == parked || state_.compare_exchange_weak(s, parked, std::memory_order_relaxed))
+                {
+                    const auto remaining = std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - std::chrono::steady_clock::now()).count();
+                    if (remaining <= 0)
+                    {
+                        // Leave the parked state, unless a notification came in the meantime
+                        s = parked;
+                        if (state_.compare_exchange_strong(s, empty, std::memory_order_relaxed))
+                        {
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    timespec timeout;
+                    timeout.tv_sec  = time_t(remaining / 1000000000);
+                    timeout.tv_nsec = long(remaining % 1000000000);
+                    futex(FUTEX_WAIT_PRIVATE, parked, &timeout);
+                    s = state_.load(std::memory_order_acquire);
+                }
+            }
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        long futex(int op, int32_t value, const timespec *pTimeout)
+        {
+            return syscall(SYS_futex, reinterpret_cast<int32_t*>(&state_), op, value, pTimeout, nullptr, 0);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static constexpr int32_t empty      = 0;
+        static constexpr int32_t notified   = 1;
+        static constexpr int32_t parked     = -1;
+
+        static_assert(sizeof(std::atomic<int32_t>) == sizeof(int32_t), "The futex word has to be a plain 32 bits integer.");
+
+        std::atomic<int32_t> state_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -0,0 +1,12 @@
+#pragma once
+
+#include "oqpi/platform.hpp"
+
+// Platform specific implementations
+#if OQPI_PLATFORM_WIN
+#	include "oqpi/threading/win_fiber.hpp"
+#elif OQPI_PLATFORM_POSIX
+#   include "oqpi/threading/posix_fiber.hpp"
+#else
+#	error No fiber implementation defined for the current platform
+#endif
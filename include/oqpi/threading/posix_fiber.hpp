@@ -0,0 +1,125 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <unistd.h>
+#include <ucontext.h>
+#include <sys/mman.h>
+
+#include "oqpi/platform.hpp"
+#include "oqpi/error_handling.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Type definition of this platform fiber implementation
+    using fiber_impl = class posix_fiber;
+    //----------------------------------------------------------------------------------------------
+    // Execution context based on ucontext, either the one of a thread switching to fibers or the
+    // one of a fiber running a function on its own stack.
+    // The stack of a fiber is mapped on its own with a guard page below it, so that an overflow
+    // crashes right away instead of silently corrupting the memory next to it.
+    //
+    class posix_fiber
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using entry_point = void(*)(void*);
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Context of the calling thread, filled when switching away from it
+        posix_fiber()
+            : pStack_(nullptr)
+            , mappedSize_(0)
+            , entry_(nullptr)
+            , pArg_(nullptr)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Fiber calling entry(pArg) the first time it's switched to. The entry point must never
+        // return, it has to switch to another context instead.
+        posix_fiber(size_t stackSize, entry_point entry, void *pArg)
+            : pStack_(nullptr)
+            , mappedSize_(0)
+            , entry_(entry)
+            , pArg_(pArg)
+        {
+            const auto pageSize = size_t(sysconf(_SC_PAGESIZE));
+            mappedSize_ = ((stackSize + pageSize - 1) / pageSize + 1) * pageSize;
+
+            auto flags = MAP_PRIVATE | MAP_ANONYMOUS;
+#if defined(MAP_STACK)
+            flags |= MAP_STACK;
+#endif
+            pStack_ = mmap(nullptr, mappedSize_, PROT_READ | PROT_WRITE, flags, -1, 0);
+            if (!oqpi_ensuref(pStack_ != MAP_FAILED, "Failed to map a fiber stack of %zu bytes", mappedSize_))
+            {
+                pStack_ = nullptr;
+                return;
+            }
+
+            // Stacks grow down, the guard page is the lowest one
+            mprotect(pStack_, pageSize, PROT_NONE);
+
+            getcontext(&context_);
+            context_.uc_stack.ss_sp     = static_cast<char*>(pStack_) + pageSize;
+            context_.uc_stack.ss_size   = mappedSize_ - pageSize;
+            context_.uc_link            = nullptr;
+
+            // makecontext only forwards ints, the pointer to this is split in two
+            const auto self = uint64_t(uintptr_t(this));
+            makecontext(&context_, reinterpret_cast<void(*)()>(&posix_fiber::trampoline), 2, uint32_t(self >> 32), uint32_t(self));
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~posix_fiber()
+        {
+            if (pStack_)
+            {
+                munmap(pStack_, mappedSize_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable nor movable, the context points to this
+        posix_fiber(const posix_fiber &)                = delete;
+        posix_fiber& operator =(const posix_fiber &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return pStack_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Saves the current context in from and resumes to. Returns once something switches back
+        // to from, possibly from another thread.
+        static void switch_to(posix_fiber &from, posix_fiber &to)
+        {
+            swapcontext(&from.context_, &to.context_);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static void trampoline(uint32_t high, uint32_t low)
+        {
+            auto pThis = reinterpret_cast<posix_fiber*>(uintptr_t((uint64_t(high) << 32) | uint64_t(low)));
+            pThis->entry_(pThis->pArg_);
+            oqpi_checkf(false, "A fiber entry point returned");
+        }
+
+    private:
+        ucontext_t  context_;
+        // Mapped memory of the stack, guard page included, null for the context of a thread
+        void       *pStack_;
+        size_t      mappedSize_;
+        // Function to run on the fiber
+        entry_point entry_;
+        void       *pArg_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
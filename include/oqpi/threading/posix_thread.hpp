@@ -6,6 +6,9 @@
 #include <math.h>
 #include <cstring>
 #include <sys/resource.h>
+#if defined(__linux__)
+#   include <sys/syscall.h>
+#endif
 
 #include "oqpi/platform.hpp"
 #include "oqpi/error_handling.hpp"
@@ -415,6 +418,20 @@ namespace oqpi {
             return sched_getcpu();
         }
         //------------------------------------------------------------------------------------------
+        inline uint32_t get_current_numa_node()
+        {
+            // Retrieves the NUMA node of the processor the current thread was running on during
+            // the call to this function, 0 if it can't be determined.
+#if defined(__linux__) && defined(SYS_getcpu)
+            unsigned cpu = 0, node = 0;
+            if (syscall(SYS_getcpu, &cpu, &node, nullptr) == 0)
+            {
+                return node;
+            }
+#endif
+            return 0;
+        }
+        //------------------------------------------------------------------------------------------
         inline void yield() noexcept
         {
             // sched_yield() causes the calling thread to relinquish the CPU.
@@ -4,6 +4,11 @@
 #include "oqpi/threading/thread.hpp"
 #include "oqpi/threading/thread_attributes.hpp"
 
+#if defined(__i386__) || defined(__x86_64__) || defined(_M_IX86) || defined(_M_X64)
+#   define OQPI_ARCH_X86 (1)
+#   include <immintrin.h>
+#endif
+
 
 namespace oqpi { namespace this_thread {
 
@@ -17,10 +22,31 @@ namespace oqpi { namespace this_thread {
     uint32_t get_current_core();
     //----------------------------------------------------------------------------------------------
 
+    //----------------------------------------------------------------------------------------------
+    // Retrieves the NUMA node of the processor the current thread was running on during the call
+    // to this function.
+    uint32_t get_current_numa_node();
+    //----------------------------------------------------------------------------------------------
+
     //----------------------------------------------------------------------------------------------
     void yield() noexcept;
     //----------------------------------------------------------------------------------------------
 
+    //----------------------------------------------------------------------------------------------
+    // Tells the processor that the calling thread is in a spin loop, without giving up its time
+    // slice. Cheaper than yield, to be used in busy loops.
+    inline void pause() noexcept
+    {
+#if defined(OQPI_ARCH_X86)
+        _mm_pause();
+#elif defined(_M_ARM64)
+        __yield();
+#elif defined(__aarch64__) || defined(__arm__)
+        __asm__ __volatile__("yield");
+#endif
+    }
+    //----------------------------------------------------------------------------------------------
+
     //----------------------------------------------------------------------------------------------
     void set_priority(thread_priority threadPriority);
     //----------------------------------------------------------------------------------------------
@@ -0,0 +1,97 @@
+#pragma once
+
+#include "oqpi/platform.hpp"
+#include "oqpi/error_handling.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Type definition of this platform fiber implementation
+    using fiber_impl = class win_fiber;
+    //----------------------------------------------------------------------------------------------
+    // Execution context based on the Windows fibers, either the one of a thread switching to
+    // fibers or the one of a fiber running a function on its own stack. The system puts a guard
+    // page at the end of the stack of each fiber.
+    // A thread is converted to a fiber the first time it switches to one and stays so until it
+    // exits.
+    //
+    class win_fiber
+    {
+    public:
+        //------------------------------------------------------------------------------------------
+        using entry_point = void(*)(void*);
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Context of the calling thread, filled when switching away from it
+        win_fiber()
+            : hFiber_(nullptr)
+            , ownsFiber_(false)
+            , entry_(nullptr)
+            , pArg_(nullptr)
+        {}
+
+        //------------------------------------------------------------------------------------------
+        // Fiber calling entry(pArg) the first time it's switched to. The entry point must never
+        // return, it has to switch to another context instead.
+        win_fiber(size_t stackSize, entry_point entry, void *pArg)
+            : hFiber_(nullptr)
+            , ownsFiber_(true)
+            , entry_(entry)
+            , pArg_(pArg)
+        {
+            hFiber_ = CreateFiber(stackSize, &win_fiber::trampoline, this);
+            oqpi_checkf(hFiber_ != nullptr, "Failed to create a fiber: %d", GetLastError());
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~win_fiber()
+        {
+            if (ownsFiber_ && hFiber_)
+            {
+                DeleteFiber(hFiber_);
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable nor movable, the fiber points to this
+        win_fiber(const win_fiber &)                = delete;
+        win_fiber& operator =(const win_fiber &)    = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        bool isValid() const
+        {
+            return hFiber_ != nullptr;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Saves the current context in from and resumes to. Returns once something switches back
+        // to from, possibly from another thread.
+        static void switch_to(win_fiber &from, win_fiber &to)
+        {
+            from.hFiber_ = IsThreadAFiber() ? GetCurrentFiber() : ConvertThreadToFiber(nullptr);
+            SwitchToFiber(to.hFiber_);
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        static void WINAPI trampoline(void *pArg)
+        {
+            auto pThis = static_cast<win_fiber*>(pArg);
+            pThis->entry_(pThis->pArg_);
+            oqpi_checkf(false, "A fiber entry point returned");
+        }
+
+    private:
+        LPVOID      hFiber_;
+        // False for the context of a thread, its fiber is released when the thread exits
+        bool        ownsFiber_;
+        // Function to run on the fiber
+        entry_point entry_;
+        void       *pArg_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
@@ -374,6 +374,16 @@ namespace oqpi {
             return GetCurrentProcessorNumber();
         }
         //------------------------------------------------------------------------------------------
+        inline uint32_t get_current_numa_node()
+        {
+            // Retrieves the NUMA node of the processor the current thread was running on during
+            // the call to this function, 0 if it can't be determined.
+            PROCESSOR_NUMBER processorNumber;
+            GetCurrentProcessorNumberEx(&processorNumber);
+            USHORT node = 0;
+            return GetNumaProcessorNodeEx(&processorNumber, &node) ? uint32_t(node) : 0u;
+        }
+        //------------------------------------------------------------------------------------------
         inline void yield() noexcept
         {
             // Causes the calling thread to yield execution to another thread that is ready to run
@@ -0,0 +1,253 @@
+#pragma once
+
+#include <memory>
+#include <vector>
+#include <atomic>
+#include <cstdint>
+#include <iterator>
+#include <type_traits>
+
+#include "oqpi/platform.hpp"
+
+
+namespace oqpi {
+
+    //----------------------------------------------------------------------------------------------
+    // Chase-Lev work stealing deque.
+    // Only the owner of the deque is allowed to call push and tryPop, they operate on the bottom
+    // of the deque in a LIFO fashion. Any other thread can call trySteal which takes elements from
+    // the top of the deque (FIFO).
+    // The storage grows when full, old buffers are kept alive until the deque is destroyed as
+    // thieves might still be reading from them.
+    //
+    // A thief can read a slot that the owner is overwriting, so slots can only hold trivially
+    // copyable values. Other types are boxed on the heap and moved in and out of the box.
+    //
+    template<typename T>
+    class work_stealing_deque
+    {
+        //------------------------------------------------------------------------------------------
+        static constexpr auto is_boxed = !std::is_trivially_copyable<T>::value;
+        using slot_type = std::conditional_t<is_boxed, T*, T>;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        explicit work_stealing_deque(int64_t initialCapacity = 256)
+            : top_(0)
+            , bottom_(0)
+        {
+            // The capacity has to be a power of 2
+            int64_t capacity = 1;
+            while (capacity < initialCapacity)
+            {
+                capacity <<= 1;
+            }
+            buffers_.emplace_back(std::make_unique<buffer>(capacity));
+            pBuffer_.store(buffers_.back().get(), std::memory_order_relaxed);
+        }
+
+        //------------------------------------------------------------------------------------------
+        ~work_stealing_deque()
+        {
+            if (is_boxed)
+            {
+                slot_type slot;
+                while (popSlot(slot))
+                {
+                    release(slot);
+                }
+            }
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Not copyable
+        work_stealing_deque(const work_stealing_deque &)            = delete;
+        work_stealing_deque& operator =(const work_stealing_deque &) = delete;
+
+    public:
+        //------------------------------------------------------------------------------------------
+        // Owner only
+        void push(T &&t)
+        {
+            pushSlot(box(std::move(t)));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Owner only
+        void push(const T &t)
+        {
+            pushSlot(box(T(t)));
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Owner only, the whole range becomes visible to the thieves at once
+        template<typename _Iterator>
+        void pushBatch(_Iterator first, _Iterator last)
+        {
+            const auto b    = bottom_.load(std::memory_order_relaxed);
+            const auto t    = top_.load(std::memory_order_acquire);
+            const auto n    = int64_t(std::distance(first, last));
+            auto pBuffer    = pBuffer_.load(std::memory_order_relaxed);
+
+            while (b - t + n > pBuffer->capacity())
+            {
+                pBuffer = grow(pBuffer, t, b);
+            }
+
+            for (auto i = b; first != last; ++first, ++i)
+            {
+                pBuffer->put(i, box(T(*first)));
+            }
+            bottom_.store(b + n, std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Owner only, returns the most recently pushed element
+        bool tryPop(T &v)
+        {
+            slot_type slot;
+            if (popSlot(slot))
+            {
+                v = unbox(slot);
+                return true;
+            }
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Any thread, returns the least recently pushed element
+        bool trySteal(T &v)
+        {
+            auto t = top_.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            const auto b = bottom_.load(std::memory_order_acquire);
+
+            if (t < b)
+            {
+                // The value has to be read before the CAS, once top_ moves the owner can reuse the slot
+                const auto slot = pBuffer_.load(std::memory_order_acquire)->get(t);
+                if (top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                {
+                    v = unbox(slot);
+                    return true;
+                }
+            }
+
+            return false;
+        }
+
+        //------------------------------------------------------------------------------------------
+        // Approximation, only exact if the deque is not concurrently modified
+        bool empty() const
+        {
+            const auto b = bottom_.load(std::memory_order_relaxed);
+            const auto t = top_.load(std::memory_order_relaxed);
+            return b <= t;
+        }
+
+    private:
+        //------------------------------------------------------------------------------------------
+        struct buffer
+        {
+            explicit buffer(int64_t capacity)
+                : mask(capacity - 1)
+                , slots(new std::atomic<slot_type>[size_t(capacity)])
+            {}
+
+            int64_t     capacity()                        const { return mask + 1;                                                  }
+            slot_type   get(int64_t i)                    const { return slots[i & mask].load(std::memory_order_relaxed);          }
+            void        put(int64_t i, slot_type slot)          { slots[i & mask].store(slot, std::memory_order_relaxed);          }
+
+            const int64_t                               mask;
+            std::unique_ptr<std::atomic<slot_type>[]>   slots;
+        };
+
+    private:
+        //------------------------------------------------------------------------------------------
+        void pushSlot(slot_type slot)
+        {
+            const auto b    = bottom_.load(std::memory_order_relaxed);
+            const auto t    = top_.load(std::memory_order_acquire);
+            auto pBuffer    = pBuffer_.load(std::memory_order_relaxed);
+
+            if (b - t > pBuffer->capacity() - 1)
+            {
+                pBuffer = grow(pBuffer, t, b);
+            }
+
+            pBuffer->put(b, slot);
+            bottom_.store(b + 1, std::memory_order_release);
+        }
+
+        //------------------------------------------------------------------------------------------
+        bool popSlot(slot_type &slot)
+        {
+            const auto b        = bottom_.load(std::memory_order_relaxed) - 1;
+            const auto pBuffer  = pBuffer_.load(std::memory_order_relaxed);
+            bottom_.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = top_.load(std::memory_order_relaxed);
+
+            if (t > b)
+            {
+                // Empty deque
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return false;
+            }
+
+            slot = pBuffer->get(b);
+            if (t == b)
+            {
+                // Last element, race against the thieves
+                const auto won = top_.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+                bottom_.store(b + 1, std::memory_order_relaxed);
+                return won;
+            }
+
+            return true;
+        }
+
+        //------------------------------------------------------------------------------------------
+        buffer* grow(buffer *pOldBuffer, int64_t t, int64_t b)
+        {
+            auto upNewBuffer = std::make_unique<buffer>(pOldBuffer->capacity() * 2);
+            for (auto i = t; i != b; ++i)
+            {
+                upNewBuffer->put(i, pOldBuffer->get(i));
+            }
+
+            auto pNewBuffer = upNewBuffer.get();
+            buffers_.emplace_back(std::move(upNewBuffer));
+            pBuffer_.store(pNewBuffer, std::memory_order_release);
+            return pNewBuffer;
+        }
+
+        //------------------------------------------------------------------------------------------
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<_Boxed, slot_type> box(T &&t)       { return new T(std::move(t));  }
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<!_Boxed, slot_type> box(T &&t)      { return t;                     }
+        //------------------------------------------------------------------------------------------
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<_Boxed, T> unbox(slot_type slot)    { return T(std::move(*std::unique_ptr<T>(slot)));   }
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<!_Boxed, T> unbox(slot_type slot)   { return slot;                                      }
+        //------------------------------------------------------------------------------------------
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<_Boxed> release(slot_type slot)     { delete slot;  }
+        template<bool _Boxed = is_boxed>
+        static std::enable_if_t<!_Boxed> release(slot_type)         {               }
+
+    private:
+        // Thieves increment the top, it's on its own cache line as it's the contended end
+        alignas(OQPI_CACHE_LINE_SIZE) std::atomic<int64_t>  top_;
+        // Only written by the owner
+        alignas(OQPI_CACHE_LINE_SIZE) std::atomic<int64_t>  bottom_;
+        // Current storage
+        std::atomic<buffer*>                                pBuffer_;
+        // Every buffer ever allocated, only touched by the owner
+        std::vector<std::unique_ptr<buffer>>                buffers_;
+    };
+    //----------------------------------------------------------------------------------------------
+
+} /*oqpi*/
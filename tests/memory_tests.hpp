@@ -0,0 +1,95 @@
+#pragma once
+
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Slab pool.", "[memory]")
+{
+    // Freed blocks are reused by the thread owning them
+    auto p0 = oqpi::slab_pool::allocate(48);
+    oqpi::slab_pool::deallocate(p0, 48);
+    auto p1 = oqpi::slab_pool::allocate(60);
+    CHECK(p1 == p0);
+
+    // Each size class has its own blocks
+    auto p2 = oqpi::slab_pool::allocate(200);
+    CHECK(p2 != p1);
+    CHECK(reinterpret_cast<uintptr_t>(p2) % oqpi::slab_pool::min_block_size == 0);
+
+    // Too big for the pool
+    auto p3 = oqpi::slab_pool::allocate(oqpi::slab_pool::max_block_size + 1);
+    REQUIRE(p3 != nullptr);
+    oqpi::slab_pool::deallocate(p3, oqpi::slab_pool::max_block_size + 1);
+
+    // Blocks freed by another thread go back to the heap they come from
+    std::vector<void*> blocks;
+    for (auto i = 0; i < 1000; ++i)
+    {
+        blocks.push_back(oqpi::slab_pool::allocate(128));
+    }
+    auto th = oqpi::thread("RemoteFree", [&blocks]
+    {
+        for (auto p : blocks)
+        {
+            oqpi::slab_pool::deallocate(p, 128);
+        }
+    });
+    th.join();
+
+    std::sort(blocks.begin(), blocks.end());
+    for (auto i = 0; i < 1000; ++i)
+    {
+        CHECK(std::binary_search(blocks.begin(), blocks.end(), oqpi::slab_pool::allocate(128)));
+    }
+
+    oqpi::slab_pool::deallocate(p1, 60);
+    oqpi::slab_pool::deallocate(p2, 200);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_slab_allocated_tasks()
+{
+    TEST_FUNC;
+
+    using slab_tk = oqpi::helpers<oqpi::scheduler<concurrent_queue>, oqpi::empty_group_context, oqpi::empty_task_context, oqpi::manual_reset_event_interface<>, oqpi::slab_allocator<char>>;
+    slab_tk::start_default_scheduler(4);
+
+    // Tasks created here and released by the workers
+    std::atomic<int> count(0);
+    for (auto i = 0; i < 10000; ++i)
+    {
+        slab_tk::fire_and_forget_task("FireAndForget", [&count] { ++count; });
+    }
+
+    auto spFork = slab_tk::make_parallel_group<oqpi::task_type::waitable>("Fork", oqpi::task_priority::normal, 64);
+    for (auto i = 0; i < 64; ++i)
+    {
+        // Created and released by the workers
+        spFork->addTask(slab_tk::make_task_item("Nested", [&count]
+        {
+            auto spSeq = slab_tk::make_sequence_group<oqpi::task_type::fire_and_forget>("Sequence");
+            for (auto j = 0; j < 16; ++j)
+            {
+                spSeq->addTask(slab_tk::make_task_item("Leaf", [&count] { ++count; }));
+            }
+            slab_tk::schedule_task(oqpi::task_handle(spSeq));
+        }));
+    }
+    slab_tk::schedule_task(oqpi::task_handle(spFork)).wait();
+    slab_tk::parallel_for("ParallelFor", 1000, [&count](int32_t) { ++count; });
+
+    // Fire and forget tasks can't be waited on
+    const auto start = std::chrono::steady_clock::now();
+    while (count.load() < 10000 + 64 * 16 + 1000 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(count.load() == 10000 + 64 * 16 + 1000);
+
+    slab_tk::stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Slab allocated tasks.", "[memory]")
+{
+    test_slab_allocated_tasks();
+}
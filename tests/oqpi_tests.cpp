@@ -33,6 +33,10 @@ TEST_CASE("Setup.", "[cleanup]")
 
 #include "parallel_algorithms_tests.hpp"
 
+#include "queue_tests.hpp"
+
+#include "memory_tests.hpp"
+
 #include "event_tests.hpp"
 
 #include "mutex_tests.hpp"
@@ -0,0 +1,254 @@
+//--------------------------------------------------------------------------------------------------
+template<typename _Queue>
+void test_queue_contract(_Queue &queue)
+{
+    int v = 0;
+    REQUIRE(queue.empty());
+    REQUIRE(!queue.tryPop(v));
+
+    for (int i = 0; i < 100; ++i)
+    {
+        queue.push(i);
+    }
+    REQUIRE(!queue.empty());
+
+    for (int i = 0; i < 100; ++i)
+    {
+        REQUIRE(queue.tryPop(v));
+        REQUIRE(v == i);
+    }
+    REQUIRE(queue.empty());
+    REQUIRE(!queue.tryPop(v));
+
+    // Batches keep the order as well
+    std::vector<int> batch;
+    for (int i = 0; i < 100; ++i)
+    {
+        batch.push_back(i);
+    }
+    queue.pushBatch(batch.begin(), batch.begin() + 10);
+    queue.pushBatch(batch.begin() + 10, batch.end());
+    for (int i = 0; i < 100; ++i)
+    {
+        REQUIRE(queue.tryPop(v));
+        REQUIRE(v == i);
+    }
+    REQUIRE(queue.empty());
+}
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Queue>
+void test_queue_concurrency(_Queue &queue)
+{
+    constexpr auto producerCount    = 4;
+    constexpr auto consumerCount    = 4;
+    constexpr auto itemsPerProducer = 20000;
+
+    std::atomic<int64_t> sum(0);
+    std::atomic<int>     popped(0);
+    std::vector<oqpi::thread> threads;
+
+    for (auto p = 0; p < producerCount; ++p)
+    {
+        threads.emplace_back("Producer", [&queue]
+        {
+            for (auto i = 1; i <= itemsPerProducer; ++i)
+            {
+                queue.push(i);
+            }
+        });
+    }
+    for (auto c = 0; c < consumerCount; ++c)
+    {
+        threads.emplace_back("Consumer", [&queue, &sum, &popped]
+        {
+            int v = 0;
+            while (popped.load() < producerCount * itemsPerProducer)
+            {
+                if (queue.tryPop(v))
+                {
+                    sum += v;
+                    ++popped;
+                }
+            }
+        });
+    }
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    REQUIRE(sum.load() == int64_t(producerCount) * itemsPerProducer * (itemsPerProducer + 1) / 2);
+    REQUIRE(queue.empty());
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Queues.", "[queue]")
+{
+    SECTION("Concurrent queue.")
+    {
+        concurrent_queue<int> queue;
+        test_queue_contract(queue);
+        test_queue_concurrency(queue);
+    }
+    SECTION("Ring queue.")
+    {
+        oqpi::ring_queue<int> queue;
+        test_queue_contract(queue);
+        test_queue_concurrency(queue);
+    }
+    SECTION("Ring queue overflow.")
+    {
+        // Way smaller than the number of elements pushed, most of them will be spilled
+        oqpi::mpmc_ring_queue<int, 16> queue;
+        REQUIRE(queue.tryPush(0));
+        int v = -1;
+        REQUIRE(queue.tryPop(v));
+        REQUIRE(v == 0);
+
+        for (int i = 0; i < 16; ++i)
+        {
+            REQUIRE(queue.tryPush(int(i)));
+        }
+        REQUIRE(!queue.tryPush(16));
+        while (queue.tryPop(v));
+
+        test_queue_contract(queue);
+        test_queue_concurrency(queue);
+    }
+    SECTION("Ring queue partial batches.")
+    {
+        // Batches take whatever room is left in the ring and only spill the rest
+        oqpi::mpmc_ring_queue<int, 16> queue;
+        std::vector<int> batch;
+        for (int i = 0; i < 40; ++i)
+        {
+            batch.push_back(i);
+        }
+        REQUIRE(queue.tryPush(-1));
+        REQUIRE(queue.tryPushBatch(batch.begin(), 20) == 15);
+        REQUIRE(queue.tryPushBatch(batch.begin(), 20) == 0);
+        int v = 0;
+        while (queue.tryPop(v));
+
+        REQUIRE(queue.tryPush(-1));
+        queue.pushBatch(batch.begin(), batch.end());
+        // The ring has been filled before spilling
+        REQUIRE(!queue.tryPush(-2));
+        REQUIRE(queue.tryPop(v));
+        REQUIRE(v == -1);
+        for (int i = 0; i < 40; ++i)
+        {
+            REQUIRE(queue.tryPop(v));
+            REQUIRE(v == i);
+        }
+        REQUIRE(queue.empty());
+
+        // Batches way bigger than the ring, against single pushes
+        constexpr auto batchCount   = 200;
+        constexpr auto singleCount  = 20000;
+        std::atomic<int64_t> sum(0);
+        std::atomic<int>     popped(0);
+        std::vector<oqpi::thread> threads;
+        threads.emplace_back("BatchProducer", [&queue, &batch]
+        {
+            for (auto i = 0; i < batchCount; ++i)
+            {
+                queue.pushBatch(batch.begin(), batch.end());
+            }
+        });
+        threads.emplace_back("Producer", [&queue]
+        {
+            for (auto i = 1; i <= singleCount; ++i)
+            {
+                queue.push(i);
+            }
+        });
+        threads.emplace_back("Consumer", [&queue, &sum, &popped]
+        {
+            int value = 0;
+            while (popped.load() < batchCount * 40 + singleCount)
+            {
+                if (queue.tryPop(value))
+                {
+                    sum += value;
+                    ++popped;
+                }
+            }
+        });
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+        REQUIRE(sum.load() == int64_t(batchCount) * (39 * 40 / 2) + int64_t(singleCount) * (singleCount + 1) / 2);
+        REQUIRE(queue.empty());
+    }
+    SECTION("Work stealing deque.")
+    {
+        oqpi::work_stealing_deque<int> deque(4);
+        int v = 0;
+        REQUIRE(deque.empty());
+        for (int i = 0; i < 100; ++i)
+        {
+            deque.push(i);
+        }
+        // The owner pops from the bottom, thieves steal from the top
+        REQUIRE(deque.tryPop(v));
+        REQUIRE(v == 99);
+        REQUIRE(deque.trySteal(v));
+        REQUIRE(v == 0);
+
+        int64_t sum = 0;
+        while (deque.tryPop(v))
+        {
+            sum += v;
+        }
+        REQUIRE(sum == 99 * 100 / 2 - 99);
+        REQUIRE(deque.empty());
+
+        std::vector<int> batch;
+        for (int i = 0; i < 100; ++i)
+        {
+            batch.push_back(i);
+        }
+        deque.pushBatch(batch.begin(), batch.end());
+        REQUIRE(deque.trySteal(v));
+        REQUIRE(v == 0);
+        REQUIRE(deque.tryPop(v));
+        REQUIRE(v == 99);
+        while (deque.tryPop(v));
+        REQUIRE(deque.empty());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_ring_queue_scheduler()
+{
+    TEST_FUNC;
+
+    using rq_tk = oqpi::helpers<oqpi::scheduler<oqpi::ring_queue>>;
+    rq_tk::start_default_scheduler(4);
+
+    std::atomic<int> count(0);
+    for (auto i = 0; i < 10000; ++i)
+    {
+        rq_tk::fire_and_forget_task("FireAndForget", [&count] { ++count; });
+    }
+    rq_tk::parallel_for("ParallelFor", 1000, [&count](int32_t) { ++count; });
+
+    // Fire and forget tasks can't be waited on
+    const auto start = std::chrono::steady_clock::now();
+    while (count.load() < 11000 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(count.load() == 11000);
+
+    rq_tk::stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Scheduler with a ring queue.", "[queue]")
+{
+    test_ring_queue_scheduler();
+}
@@ -109,3 +109,2070 @@ TEST_CASE("Scheduling (tasks, sequence groups, parallel groups).", "[scheduling]
 {
     CHECK_NOTHROW(test_scheduling());
 }
+
+//--------------------------------------------------------------------------------------------------
+void test_work_stealing()
+{
+    TEST_FUNC;
+
+    using ws_tk = oqpi::helpers<oqpi::work_stealing_scheduler<concurrent_queue>>;
+    ws_tk::start_default_scheduler(4);
+
+    // Each task of the fork spawns a nested fork from its worker thread, those end up in the
+    // worker's local queue and get stolen by the others
+    std::atomic<int> count(0);
+    // Keeps the work of the leaves from being optimized away
+    std::atomic<uint64_t> sink(0);
+    auto spFork = ws_tk::make_parallel_group<oqpi::task_type::waitable>("Fork", oqpi::task_priority::normal, gTaskCount);
+    for (auto i = 0; i < gTaskCount; ++i)
+    {
+        spFork->addTask(ws_tk::make_task_item("NestedFork" + std::to_string(i), [&count, &sink]
+        {
+            auto spNestedFork = ws_tk::make_parallel_group<oqpi::task_type::waitable>("Nested", oqpi::task_priority::high, 16);
+            for (auto j = 0; j < 16; ++j)
+            {
+                spNestedFork->addTask(ws_tk::make_task_item("Leaf", [&count, &sink]
+                {
+                    sink += fibonacci(gValue / 100);
+                    ++count;
+                }));
+            }
+            ws_tk::schedule_task(oqpi::task_handle(spNestedFork)).activeWait();
+        }));
+    }
+    ws_tk::schedule_task(oqpi::task_handle(spFork)).wait();
+    CHECK(count.load() == gTaskCount * 16);
+    CHECK(sink.load() != 0);
+
+    ws_tk::parallel_for("ParallelFor", 1000, [&count](int32_t) { ++count; });
+    CHECK(count.load() == gTaskCount * 16 + 1000);
+
+    CHECK(ws_tk::scheduler().waitIdleFor(std::chrono::seconds(10)));
+    CHECK(ws_tk::scheduler().isIdle());
+
+    ws_tk::stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Work stealing scheduler.", "[scheduling]")
+{
+    test_work_stealing();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_targeted_wake_up()
+{
+    TEST_FUNC;
+
+    // Workers only able to work on high priority tasks and workers for everything else, each task
+    // has to wake up a worker of the right kind
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config configs[2];
+    configs[0].workerPrio = oqpi::worker_priority::wprio_high;
+    configs[0].count      = 2;
+    configs[1].workerPrio = oqpi::worker_priority::wprio_normal_or_low;
+    configs[1].count      = 2;
+    sc.registerWorkers<oqpi::thread_interface<>, oqpi::semaphore_interface<>>(configs);
+    sc.start();
+
+    std::atomic<int> count(0);
+    const auto addTask = [&sc, &count](oqpi::task_priority prio)
+    {
+        sc.add(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "WakeUp", prio, [&count] { ++count; }
+        )));
+    };
+    const auto waitForCount = [&count](int expected)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (count.load() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        {
+            oqpi::this_thread::yield();
+        }
+        return count.load() == expected;
+    };
+
+    // One task at a time, the workers go back to sleep in between
+    auto expected = 0;
+    for (auto i = 0; i < 200; ++i)
+    {
+        addTask(i % 2 ? oqpi::task_priority::high : oqpi::task_priority::low);
+        REQUIRE(waitForCount(++expected));
+    }
+
+    // Bursts
+    for (auto i = 0; i < 20; ++i)
+    {
+        for (auto j = 0; j < 50; ++j)
+        {
+            addTask(oqpi::task_priority(j % int(oqpi::task_priority::count)));
+        }
+        expected += 50;
+        REQUIRE(waitForCount(expected));
+    }
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Targeted wake up.", "[scheduling]")
+{
+    test_targeted_wake_up();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_idle_policy()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count                    = 2;
+    config.idlePolicy.spinCount     = 2000;
+    config.idlePolicy.minSpinCount  = 16;
+    config.idlePolicy.yieldCount    = 4;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    std::atomic<int> count(0);
+    auto expected = 0;
+    for (auto i = 0; i < 100; ++i)
+    {
+        // Alternate between bursts and single tasks with pauses in between
+        const auto taskCount = (i % 2) ? 20 : 1;
+        for (auto j = 0; j < taskCount; ++j)
+        {
+            sc.add(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+            (
+                "Idle", oqpi::task_priority::normal, [&count] { ++count; }
+            )));
+        }
+        expected += taskCount;
+
+        const auto start = std::chrono::steady_clock::now();
+        while (count.load() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        {
+            oqpi::this_thread::yield();
+        }
+        REQUIRE(count.load() == expected);
+    }
+
+    // Every task has been found during one of the phases
+    uint64_t totalFound = 0;
+    for (auto w = 0; w < sc.workersTotalCount(); ++w)
+    {
+        const auto stats = sc.workerIdleStats(w);
+        for (const auto found : stats.found)
+        {
+            totalFound += found;
+        }
+        CHECK(stats.spinBudget >= config.idlePolicy.minSpinCount);
+        CHECK(stats.spinBudget <= config.idlePolicy.spinCount);
+    }
+    CHECK(totalFound == uint64_t(expected));
+
+    sc.stop();
+
+    // Default bounds: tasks coming after long pauses shrink the spin budget but it can still
+    // grow back, and the default policy never spins at all
+    for (const auto spinCount : { 2000, 0 })
+    {
+        oqpi::scheduler<concurrent_queue> defaultSc;
+        oqpi::worker_config defaultConfig;
+        defaultConfig.idlePolicy.spinCount = spinCount;
+        defaultSc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(defaultConfig);
+        defaultSc.start();
+
+        for (auto i = 0; i < 20; ++i)
+        {
+            oqpi::this_thread::sleep_for(std::chrono::milliseconds(2));
+            defaultSc.add(oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+            (
+                "Late", oqpi::task_priority::normal, [] {}
+            ))).wait();
+        }
+
+        const auto stats = defaultSc.workerIdleStats(0);
+        CHECK(stats.found[int(oqpi::idle_phase::park)] > 0);
+        CHECK(stats.spinBudget >= std::min(spinCount, 1));
+        CHECK(stats.spinBudget <= spinCount);
+        defaultSc.stop();
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Idle policy.", "[scheduling]")
+{
+    test_idle_policy();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_elastic_workers()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count                        = 1;
+    config.elastic.maxCount             = 4;
+    config.elastic.spawnWaitThreshold   = std::chrono::microseconds(100);
+    config.elastic.retireIdleTime       = std::chrono::milliseconds(20);
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    CHECK(sc.workersTotalCount() == 4);
+    CHECK(sc.workersActiveCount() == 1);
+    CHECK(sc.workersCount(oqpi::task_priority::normal) == 1);
+
+    const auto make_task = [](auto &&func)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Elastic", oqpi::task_priority::normal, std::forward<decltype(func)>(func)
+        ));
+    };
+
+    // Tasks piling up in the queue: workers are added
+    std::atomic<int32_t> count(0);
+    std::atomic<int32_t> maxActive(0);
+    for (auto i = 0; i < 200; ++i)
+    {
+        sc.add(make_task([&sc, &count, &maxActive]
+        {
+            oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+            const auto active = sc.workersActiveCount();
+            auto current = maxActive.load();
+            while (active > current && !maxActive.compare_exchange_weak(current, active));
+            ++count;
+        }));
+    }
+    sc.waitIdle();
+    CHECK(count.load() == 200);
+    CHECK(maxActive.load() > 1);
+    CHECK(maxActive.load() <= 4);
+
+    // Idle again: the extra workers retire, the first one stays
+    const auto start = std::chrono::steady_clock::now();
+    while (sc.workersActiveCount() > 1 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(5));
+    }
+    CHECK(sc.workersActiveCount() == 1);
+    CHECK(sc.workersCount(oqpi::task_priority::normal) == 1);
+
+    // Tasks pinned to a retired worker start it again
+    auto ran = -1;
+    auto hPinned = make_task([&sc, &ran] { ran = sc.workersActiveCount(); });
+    hPinned.setWorkerAffinity(3);
+    sc.add(hPinned).wait();
+    CHECK(ran >= 2);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Elastic workers.", "[scheduling]")
+{
+    test_elastic_workers();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_batch_submission()
+{
+    TEST_FUNC;
+
+    std::atomic<int> count(0);
+    std::vector<oqpi::task_handle> tasks;
+    for (auto i = 0; i < 1000; ++i)
+    {
+        tasks.emplace_back(oqpi_tk::make_task<oqpi::task_type::fire_and_forget>("Batch", oqpi::task_priority(i % int(oqpi::task_priority::count)), [&count] { ++count; }));
+    }
+    // Already done tasks are skipped
+    auto hDone = oqpi::task_handle(oqpi_tk::make_task<oqpi::task_type::waitable>("Done", [&count] { ++count; }));
+    hDone.executeSingleThreaded();
+    tasks.emplace_back(hDone);
+
+    oqpi_tk::scheduler().addBatch(tasks);
+    tasks.clear();
+
+    const auto start = std::chrono::steady_clock::now();
+    while (count.load() < 1001 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::yield();
+    }
+    CHECK(count.load() == 1001);
+
+    // Forks are scheduled in one batch
+    oqpi_tk::parallel_for("BatchParallelFor", 10000, [&count](int32_t) { ++count; });
+    CHECK(count.load() == 11001);
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Batch submission.", "[scheduling]")
+{
+    test_batch_submission();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Remembers the NUMA node of the worker running on the current thread
+thread_local int32_t tlsWorkerNode = -1;
+struct numa_node_context
+    : public oqpi::worker_context_base
+{
+    numa_node_context(oqpi::worker_base *pOwner)
+        : oqpi::worker_context_base(pOwner)
+    {}
+
+    void onStart() { tlsWorkerNode = owner()->getNumaNode(); }
+};
+
+//--------------------------------------------------------------------------------------------------
+template<typename _Scheduler>
+void test_numa_domains()
+{
+    TEST_FUNC;
+
+    _Scheduler sc;
+    oqpi::worker_config configs[2];
+    configs[0].numaNode = 0;
+    configs[0].count    = 2;
+    configs[1].numaNode = 1;
+    configs[1].count    = 2;
+    sc.template registerWorkers<oqpi::thread_interface<>, oqpi::default_notifier, oqpi::worker_context_container<numa_node_context>>(configs);
+    sc.start();
+    CHECK(sc.domainsCount() == 2);
+
+    std::atomic<int> count(0);
+    std::atomic<int> onPreferredNode(0);
+    const auto waitForCount = [&count](int expected)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (count.load() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        {
+            oqpi::this_thread::yield();
+        }
+        return count.load() == expected;
+    };
+
+    // One task at a time so that the workers of the preferred node are available, tasks only end
+    // up on the other node if it was looking for work at the time they were added
+    constexpr auto taskCount = 200;
+    for (auto i = 0; i < taskCount; ++i)
+    {
+        const auto node = i < taskCount / 2 ? 0 : 1;
+        auto hTask = oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Numa", oqpi::task_priority::normal, [&count, &onPreferredNode, node]
+            {
+                if (tlsWorkerNode == node)
+                {
+                    ++onPreferredNode;
+                }
+                ++count;
+            }
+        ));
+        hTask.setPreferredNode(node);
+        sc.add(hTask);
+        REQUIRE(waitForCount(i + 1));
+    }
+    CHECK(onPreferredNode.load() >= taskCount * 9 / 10);
+
+    // Children of a group go to the node of the group, and get help from the other node if needed
+    auto spGroup = oqpi::make_parallel_group<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "NumaGroup", oqpi::task_priority::normal, 64);
+    spGroup->setPreferredNode(1);
+    for (auto i = 0; i < 64; ++i)
+    {
+        spGroup->addTask(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "NumaChild", oqpi::task_priority::inherit, [&count] { ++count; }
+        )));
+    }
+    sc.add(oqpi::task_handle(spGroup)).wait();
+    CHECK(count.load() == taskCount + 64);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("NUMA domains.", "[scheduling]")
+{
+    test_numa_domains<oqpi::scheduler<concurrent_queue>>();
+    test_numa_domains<oqpi::work_stealing_scheduler<concurrent_queue>>();
+}
+
+//--------------------------------------------------------------------------------------------------
+int32_t run_flooded_scheduler(oqpi::priority_policy policy, oqpi::priority_wait_stats (&stats)[2])
+{
+    oqpi::scheduler_config schedulerConfig;
+    schedulerConfig.priorityPolicy  = policy;
+    schedulerConfig.trackWaitTimes  = true;
+    oqpi::scheduler<concurrent_queue> sc(schedulerConfig);
+
+    oqpi::worker_config config;
+    config.count = 1;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+
+    // Fill the queues before starting the single worker so that the order is deterministic
+    constexpr auto highCount    = 2000;
+    constexpr auto lowCount     = 20;
+    std::atomic<int32_t> executed(0);
+    std::atomic<int32_t> lastLow(0);
+    for (auto i = 0; i < highCount + lowCount; ++i)
+    {
+        const auto isLow = (i % (highCount / lowCount + 1)) == 0;
+        sc.add(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Flood", isLow ? oqpi::task_priority::low : oqpi::task_priority::high, [&executed, &lastLow, isLow]
+            {
+                const auto position = executed++;
+                if (isLow)
+                {
+                    lastLow = position;
+                }
+            }
+        )));
+    }
+    sc.start();
+
+    const auto start = std::chrono::steady_clock::now();
+    while (executed.load() < highCount + lowCount && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::yield();
+    }
+    CHECK(executed.load() == highCount + lowCount);
+
+    stats[0] = sc.waitStats(oqpi::task_priority::high);
+    stats[1] = sc.waitStats(oqpi::task_priority::low);
+    CHECK(stats[0].count == uint64_t(highCount));
+    CHECK(stats[1].count == uint64_t(lowCount));
+
+    sc.stop();
+    return lastLow.load();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_priority_policies()
+{
+    TEST_FUNC;
+
+    oqpi::priority_wait_stats stats[2];
+
+    // Low priority tasks only run once the high priority ones are all done
+    const auto strictLastLow = run_flooded_scheduler(oqpi::priority_policy::strict, stats);
+    CHECK(strictLastLow == 2019);
+    CHECK(stats[1].averageNs() >= stats[0].averageNs());
+
+    // Low priority tasks get 1/31 of the dequeues with the default weights
+    const auto weightedLastLow = run_flooded_scheduler(oqpi::priority_policy::weighted, stats);
+    CHECK(weightedLastLow < 1000);
+    CHECK(stats[1].maxNs >= stats[1].averageNs());
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Priority policies.", "[scheduling]")
+{
+    test_priority_policies();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_deadlines()
+{
+    TEST_FUNC;
+
+    std::atomic<int32_t> missedReported(0);
+    oqpi::scheduler_config schedulerConfig;
+    schedulerConfig.onDeadlineMissed = [&missedReported](oqpi::task_uid, int64_t latenessNs)
+    {
+        CHECK(latenessNs > 0);
+        ++missedReported;
+    };
+    oqpi::scheduler<concurrent_queue> sc(schedulerConfig);
+
+    oqpi::worker_config config;
+    config.count = 1;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+
+    const auto makeTask = [](oqpi::task_priority prio, std::function<void()> f)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Deadline", prio, std::move(f)
+        ));
+    };
+
+    std::atomic<int32_t> executed(0);
+    const auto waitForExecuted = [&executed](int32_t expected)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (executed.load() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        {
+            oqpi::this_thread::yield();
+        }
+        return executed.load() == expected;
+    };
+
+    // Fill the queues before starting the single worker: tasks with a deadline, added in a
+    // shuffled order and with the lowest priority, still come first and by deadline
+    constexpr auto plainCount       = 50;
+    constexpr auto deadlineCount    = 20;
+    std::vector<int32_t> order;
+    order.reserve(plainCount + deadlineCount);
+    const auto base = std::chrono::steady_clock::now() + std::chrono::hours(1);
+    for (auto i = 0; i < plainCount; ++i)
+    {
+        sc.add(makeTask(oqpi::task_priority::high, [&executed, &order] { order.push_back(-1); ++executed; }));
+    }
+    for (auto i = 0; i < deadlineCount; ++i)
+    {
+        const auto rank = (i * 7) % deadlineCount;
+        auto hTask = makeTask(oqpi::task_priority::low, [&executed, &order, rank] { order.push_back(rank); ++executed; });
+        hTask.setDeadline(base + std::chrono::milliseconds(rank));
+        sc.add(hTask);
+    }
+    sc.start();
+
+    REQUIRE(waitForExecuted(plainCount + deadlineCount));
+    for (auto i = 0; i < deadlineCount; ++i)
+    {
+        CHECK(order[i] == i);
+    }
+    CHECK(sc.deadlineStats().count == uint64_t(deadlineCount));
+    CHECK(sc.deadlineStats().missed == 0);
+
+    // A deadline already passed is reported once the task is done
+    auto hLate = makeTask(oqpi::task_priority::normal, [&executed] { ++executed; });
+    hLate.setDeadline(std::chrono::steady_clock::now() - std::chrono::milliseconds(1));
+    sc.add(hLate);
+    REQUIRE(waitForExecuted(plainCount + deadlineCount + 1));
+    sc.stop();
+
+    const auto stats = sc.deadlineStats();
+    CHECK(stats.count == uint64_t(deadlineCount + 1));
+    CHECK(stats.missed == 1);
+    CHECK(stats.maxLatenessNs >= uint64_t(1000000));
+    CHECK(missedReported.load() == 1);
+
+    // Workers restricted to some priorities only take the tasks with a deadline they can work on
+    oqpi::scheduler<concurrent_queue> restrictedSc;
+    oqpi::worker_config highConfig;
+    highConfig.workerPrio = oqpi::worker_priority::wprio_high;
+    restrictedSc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(highConfig);
+    oqpi::worker_config lowConfig;
+    lowConfig.workerPrio = oqpi::worker_priority::wprio_normal_or_low;
+    restrictedSc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(lowConfig);
+    restrictedSc.start();
+
+    // Odd tasks are high, they can only run on the first worker, even ones must never run there
+    executed = 0;
+    constexpr auto restrictedCount = 40;
+    std::vector<decltype(oqpi::this_thread::get_id())> threads(restrictedCount);
+    for (auto i = 0; i < restrictedCount; ++i)
+    {
+        const auto prio = (i % 2) ? oqpi::task_priority::high : oqpi::task_priority::low;
+        auto hTask = makeTask(prio, [&threads, &executed, i]
+        {
+            threads[i] = oqpi::this_thread::get_id();
+            ++executed;
+        });
+        hTask.setDeadline(std::chrono::steady_clock::now() + std::chrono::milliseconds(restrictedCount - i));
+        restrictedSc.add(hTask);
+    }
+    REQUIRE(waitForExecuted(restrictedCount));
+    restrictedSc.stop();
+
+    const auto highThread = threads[1];
+    for (auto i = 0; i < restrictedCount; ++i)
+    {
+        CHECK((threads[i] == highThread) == (i % 2 == 1));
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_group_deadline()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 2;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    // Children inherit the deadline of their group
+    std::atomic<int32_t> count(0);
+    auto spGroup = oqpi::make_parallel_group<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "DeadlineGroup", oqpi::task_priority::normal, 16);
+    spGroup->setDeadline(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    for (auto i = 0; i < 16; ++i)
+    {
+        spGroup->addTask(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "DeadlineChild", oqpi::task_priority::inherit, [&count] { ++count; }
+        )));
+    }
+    sc.add(oqpi::task_handle(spGroup)).wait();
+    CHECK(count.load() == 16);
+    sc.stop();
+
+    const auto stats = sc.deadlineStats();
+    CHECK(stats.count > 0);
+    CHECK(stats.missed == 0);
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Deadlines.", "[scheduling]")
+{
+    test_deadlines();
+    test_group_deadline();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_timer_wheel()
+{
+    TEST_FUNC;
+
+    // One tick per nanosecond so that the simulated time below is in ticks
+    oqpi::timer_wheel wheel(1, 0);
+
+    // Spread over more than the range of the wheel so that the far away timers are parked and
+    // cascaded several times
+    constexpr auto timerCount   = 20000;
+    constexpr auto range        = int64_t(1) << 26;
+    std::unordered_map<oqpi::task_uid, int64_t> expiries;
+    std::vector<oqpi::timer_handle> timers;
+    uint64_t seed = 12345;
+    const auto nextRandom = [&seed]()
+    {
+        seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+        return int64_t(seed >> 33);
+    };
+
+    for (auto i = 0; i < timerCount; ++i)
+    {
+        auto hTask = oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Timer", oqpi::task_priority::normal, [] {}
+        ));
+        const auto expiry = nextRandom() % range;
+        expiries[hTask.getUID()] = expiry;
+        auto spTimer = std::make_shared<oqpi::timer_entry>(wheel, hTask, nullptr, 0);
+        wheel.add(spTimer, expiry);
+        timers.emplace_back(std::move(spTimer));
+    }
+
+    // Cancel a quarter of them
+    auto cancelled = 0;
+    for (auto i = 0; i < timerCount; i += 4)
+    {
+        CHECK(timers[i].cancel());
+        CHECK_FALSE(timers[i].isPending());
+        expiries.erase(timers[i].getTask().getUID());
+        ++cancelled;
+    }
+    CHECK(wheel.size() == size_t(timerCount - cancelled));
+
+    auto periodicCount = 0;
+    auto spPeriodic = std::make_shared<oqpi::timer_entry>(wheel, oqpi::task_handle(), [&periodicCount]
+    {
+        ++periodicCount;
+        return oqpi::task_handle();
+    }, 0);
+    wheel.add(spPeriodic, 500, 1000);
+
+    // Every timer has to expire at the first advance past its expiry
+    std::vector<oqpi::task_handle> expired;
+    auto fired  = 0;
+    auto late   = 0;
+    int64_t previous = -1;
+    for (int64_t now = 0; now < range + (int64_t(1) << 20); now += 1 + nextRandom() % 65536)
+    {
+        CHECK(wheel.nextExpiry() > previous);
+        wheel.advance(now, expired);
+        for (const auto &hTask : expired)
+        {
+            const auto it = expiries.find(hTask.getUID());
+            REQUIRE(it != expiries.end());
+            if (it->second > now || it->second <= previous)
+            {
+                ++late;
+            }
+            expiries.erase(it);
+            ++fired;
+        }
+        expired.clear();
+        previous = now;
+    }
+
+    CHECK(late == 0);
+    CHECK(fired == timerCount - cancelled);
+    CHECK(expiries.empty());
+    CHECK(periodicCount == int((previous - 500) / 1000 + 1));
+    CHECK(wheel.size() == 1);
+
+    CHECK(oqpi::timer_handle(spPeriodic).cancel());
+    CHECK(wheel.empty());
+    CHECK(wheel.nextExpiry() == oqpi::timer_wheel::no_expiry);
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_delayed_tasks()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 1;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    using clock = std::chrono::steady_clock;
+    const auto makeTask = [](std::function<void()> f)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Delayed", oqpi::task_priority::normal, std::move(f)
+        ));
+    };
+
+    // Not run before its time, the only worker is sleeping when it's added
+    oqpi::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const auto start = clock::now();
+    auto ranAt = start;
+    auto hTimer = sc.addAfter(std::chrono::milliseconds(50), makeTask([&ranAt] { ranAt = clock::now(); }));
+    CHECK(hTimer.isPending());
+    hTimer.getTask().wait();
+    CHECK(ranAt - start >= std::chrono::milliseconds(50));
+    CHECK_FALSE(hTimer.isPending());
+
+    // Run in the order of their time, not the order they were added in
+    std::vector<int32_t> order;
+    std::vector<oqpi::timer_handle> timers;
+    for (const auto delay : { 80, 20, 60, 40, 100 })
+    {
+        timers.emplace_back(sc.addAt(clock::now() + std::chrono::milliseconds(delay), makeTask([&order, delay] { order.push_back(delay); })));
+    }
+    for (const auto &timer : timers)
+    {
+        timer.getTask().wait();
+    }
+    CHECK((order == std::vector<int32_t>{ 20, 40, 60, 80, 100 }));
+
+    // Cancelled before its time
+    std::atomic<bool> ran(false);
+    auto hCancelled = sc.addAfter(std::chrono::milliseconds(30), makeTask([&ran] { ran = true; }));
+    CHECK(hCancelled.cancel());
+    CHECK_FALSE(hCancelled.cancel());
+    oqpi::this_thread::sleep_for(std::chrono::milliseconds(60));
+    CHECK_FALSE(ran.load());
+    CHECK(sc.pendingTimersCount() == 0);
+
+    // Periodic, a new task every period until cancelled
+    std::atomic<int32_t> ticks(0);
+    auto hPeriodic = sc.addPeriodic(std::chrono::milliseconds(5), [&ticks]
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Periodic", oqpi::task_priority::normal, [&ticks] { ++ticks; }
+        ));
+    });
+    const auto periodicStart = clock::now();
+    while (ticks.load() < 5 && clock::now() - periodicStart < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(ticks.load() >= 5);
+    CHECK(hPeriodic.isPending());
+    CHECK(hPeriodic.cancel());
+    oqpi::this_thread::sleep_for(std::chrono::milliseconds(10));
+    const auto ticksAfterCancel = ticks.load();
+    oqpi::this_thread::sleep_for(std::chrono::milliseconds(30));
+    CHECK(ticks.load() == ticksAfterCancel);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_delayed_helpers()
+{
+    TEST_FUNC;
+
+    std::atomic<int32_t> count(0);
+    auto hTimer = oqpi_tk::schedule_after(std::chrono::milliseconds(10), "DelayedHelper", oqpi::task_priority::normal, [&count] { ++count; });
+    auto hPeriodic = oqpi_tk::schedule_every(std::chrono::milliseconds(5), "PeriodicHelper", oqpi::task_priority::normal, [&count] { ++count; });
+    hTimer.getTask().wait();
+
+    const auto start = std::chrono::steady_clock::now();
+    while (count.load() < 4 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(count.load() >= 4);
+    CHECK(hPeriodic.cancel());
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Timers.", "[scheduling]")
+{
+    test_timer_wheel();
+    test_delayed_tasks();
+    test_delayed_helpers();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Remembers the index of the worker running on the current thread
+thread_local int32_t tlsWorkerIndex = -1;
+struct worker_index_context
+    : public oqpi::worker_context_base
+{
+    worker_index_context(oqpi::worker_base *pOwner)
+        : oqpi::worker_context_base(pOwner)
+    {}
+
+    void onStart() { tlsWorkerIndex = owner()->getIndex(); }
+};
+
+//--------------------------------------------------------------------------------------------------
+void test_task_affinity()
+{
+    TEST_FUNC;
+
+    // Worker 0 only works on high priority tasks and is restricted to the first core, the others
+    // roam freely
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config configs[2];
+    configs[0].workerPrio                           = oqpi::worker_priority::wprio_high;
+    configs[0].threadAttributes.coreAffinityMask_   = oqpi::core_affinity::core0;
+    configs[0].count                                = 1;
+    configs[1].count                                = 3;
+    sc.registerWorkers<oqpi::thread_interface<>, oqpi::default_notifier, oqpi::worker_context_container<worker_index_context>>(configs);
+    sc.start();
+
+    std::atomic<int32_t> count(0);
+    std::atomic<int32_t> misplaced(0);
+    const auto makeTask = [&count, &misplaced](oqpi::task_priority prio, int32_t expectedWorker)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Pinned", prio, [&count, &misplaced, expectedWorker]
+            {
+                if (tlsWorkerIndex != expectedWorker)
+                {
+                    ++misplaced;
+                }
+                ++count;
+            }
+        ));
+    };
+    const auto waitForCount = [&count](int32_t expected)
+    {
+        const auto start = std::chrono::steady_clock::now();
+        while (count.load() < expected && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+        {
+            oqpi::this_thread::yield();
+        }
+        return count.load() == expected;
+    };
+
+    // Pinned to a worker, even one that does not work on the task's priority otherwise
+    constexpr auto taskCount = 400;
+    for (auto i = 0; i < taskCount; ++i)
+    {
+        const auto workerIndex = i % sc.workersTotalCount();
+        auto hTask = makeTask(i % 2 ? oqpi::task_priority::low : oqpi::task_priority::normal, workerIndex);
+        hTask.setWorkerAffinity(workerIndex);
+        sc.add(hTask);
+    }
+    REQUIRE(waitForCount(taskCount));
+    CHECK(misplaced.load() == 0);
+
+    // Pinned to a core set, only worker 0 is restricted to it. Also go through addBatch.
+    std::vector<oqpi::task_handle> batch;
+    for (auto i = 0; i < taskCount; ++i)
+    {
+        auto hTask = makeTask(oqpi::task_priority::normal, 0);
+        hTask.setCoreAffinity(oqpi::core_affinity(oqpi::core_affinity::core0 | oqpi::core_affinity::core1));
+        batch.emplace_back(std::move(hTask));
+    }
+    sc.addBatch(batch);
+    REQUIRE(waitForCount(2 * taskCount));
+    CHECK(misplaced.load() == 0);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Task affinity.", "[scheduling]")
+{
+    test_task_affinity();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_continuations()
+{
+    TEST_FUNC;
+
+    // A single worker: any continuation blocking it would deadlock
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 1;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    const auto makeTask = [](std::function<void()> f)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Continuation", oqpi::task_priority::normal, std::move(f)
+        ));
+    };
+
+    // Chain, each link only scheduled once the previous one is done
+    constexpr auto chainLength = 100;
+    std::vector<int32_t> order;
+    auto hFirst = makeTask([&order] { order.push_back(0); });
+    auto hLast  = hFirst;
+    for (auto i = 1; i < chainLength; ++i)
+    {
+        hLast = hLast.then(sc, makeTask([&order, i] { order.push_back(i); }));
+    }
+    sc.add(hFirst);
+    hLast.wait();
+    REQUIRE(order.size() == size_t(chainLength));
+    for (auto i = 0; i < chainLength; ++i)
+    {
+        CHECK(order[i] == i);
+    }
+
+    // Continuation of a task already done is scheduled right away
+    std::atomic<int32_t> count(0);
+    hFirst.then(sc, makeTask([&count] { ++count; })).wait();
+    CHECK(count.load() == 1);
+
+    // Continuation of a group, scheduled once all of its tasks are done
+    auto spGroup = oqpi::make_parallel_group<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "ContinuationGroup", oqpi::task_priority::normal, 16);
+    for (auto i = 0; i < 16; ++i)
+    {
+        spGroup->addTask(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "ContinuationChild", oqpi::task_priority::inherit, [&count] { ++count; }
+        )));
+    }
+    std::atomic<int32_t> countAfterGroup(0);
+    auto hGroup = oqpi::task_handle(spGroup);
+    auto hAfterGroup = hGroup.then(sc, makeTask([&count, &countAfterGroup] { countAfterGroup = count.load(); }));
+    sc.add(hGroup);
+    hAfterGroup.wait();
+    CHECK(countAfterGroup.load() == 17);
+
+    // when_all, scheduled once the last one is done
+    std::vector<oqpi::task_handle> handles;
+    for (auto i = 0; i < 10; ++i)
+    {
+        handles.emplace_back(makeTask([&count] { ++count; }));
+    }
+    std::atomic<int32_t> countAfterAll(0);
+    auto hAll = oqpi::when_all(sc, handles, makeTask([&count, &countAfterAll] { countAfterAll = count.load(); }));
+    CHECK_FALSE(hAll.isGrabbed());
+    sc.addBatch(handles);
+    hAll.wait();
+    CHECK(countAfterAll.load() == 27);
+
+    // when_any, scheduled exactly once, as soon as the first one is done
+    std::atomic<int32_t> anyCount(0);
+    auto hBlocker = makeTask([] {});
+    auto hFast = makeTask([] {});
+    auto hAny = oqpi::when_any(sc, { hBlocker, hFast }, makeTask([&anyCount] { ++anyCount; }));
+    sc.add(hFast);
+    hAny.wait();
+    CHECK(anyCount.load() == 1);
+    CHECK_FALSE(hBlocker.isDone());
+    sc.add(hBlocker).wait();
+    CHECK(anyCount.load() == 1);
+
+    // Nothing to wait for
+    oqpi::when_all(sc, std::vector<oqpi::task_handle>(), makeTask([&anyCount] { ++anyCount; })).wait();
+    CHECK(anyCount.load() == 2);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_continuation_helpers()
+{
+    TEST_FUNC;
+
+    std::atomic<int32_t> count(0);
+    auto hFirst = oqpi_tk::make_task("First", oqpi::task_priority::normal, [&count] { ++count; });
+    auto hSecond = oqpi_tk::then(oqpi::task_handle(hFirst), "Second", oqpi::task_priority::normal, [&count] { return ++count; });
+    auto hJoin = oqpi_tk::when_all(std::vector<oqpi::task_handle>{ hFirst, hSecond }, "Join", oqpi::task_priority::normal, [&count] { ++count; });
+    oqpi_tk::schedule_task(oqpi::task_handle(hFirst));
+    hJoin.wait();
+    CHECK(count.load() == 3);
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Continuations.", "[scheduling]")
+{
+    test_continuations();
+    test_continuation_helpers();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_task_graph()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 4;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    const auto makeNode = [](std::function<void()> f)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "GraphNode", oqpi::task_priority::inherit, std::move(f)
+        ));
+    };
+
+    // Random layered DAG, every node checks that its predecessors are done
+    constexpr auto nodeCount = 256;
+    std::vector<std::atomic<bool>> done(nodeCount);
+    std::vector<std::vector<int32_t>> predecessors(nodeCount);
+    std::atomic<int32_t> misordered(0);
+    auto spGraph = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "Graph", oqpi::task_priority::normal, nodeCount);
+    for (auto i = 0; i < nodeCount; ++i)
+    {
+        const auto id = spGraph->addNode(makeNode([&done, &predecessors, &misordered, i]
+        {
+            for (const auto p : predecessors[i])
+            {
+                if (!done[p].load())
+                {
+                    ++misordered;
+                }
+            }
+            done[i] = true;
+        }));
+        CHECK(id == i);
+    }
+    for (auto i = 1; i < nodeCount; ++i)
+    {
+        for (auto j = 0; j < 3; ++j)
+        {
+            const auto p = (i * 7 + j * 13) % i;
+            spGraph->addEdge(p, i);
+            predecessors[i].push_back(p);
+        }
+    }
+    CHECK(spGraph->nodesCount() == nodeCount);
+
+    std::atomic<int32_t> count(0);
+    auto hGraph = oqpi::task_handle(spGraph);
+    auto hAfter = hGraph.then(sc, oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "AfterGraph", oqpi::task_priority::normal, [&count] { ++count; }
+    )));
+    sc.add(hGraph).wait();
+    CHECK(misordered.load() == 0);
+    for (auto i = 0; i < nodeCount; ++i)
+    {
+        CHECK(done[i].load());
+    }
+    hAfter.wait();
+    CHECK(count.load() == 1);
+
+    // Long chain, each node runs inline on the thread that finished its predecessor
+    constexpr auto chainLength = 10000;
+    std::vector<int32_t> order;
+    order.reserve(chainLength);
+    auto spChain = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "Chain", oqpi::task_priority::normal, chainLength);
+    for (auto i = 0; i < chainLength; ++i)
+    {
+        spChain->addNode(makeNode([&order, i] { order.push_back(i); }));
+        if (i > 0)
+        {
+            spChain->addEdge(i - 1, i);
+        }
+    }
+    sc.add(oqpi::task_handle(spChain)).wait();
+    REQUIRE(order.size() == size_t(chainLength));
+    for (auto i = 0; i < chainLength; ++i)
+    {
+        CHECK(order[i] == i);
+    }
+
+    // Groups as nodes
+    count = 0;
+    auto spNested = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "Nested", oqpi::task_priority::normal);
+    auto spFork = oqpi::make_parallel_group<oqpi::task_type::fire_and_forget, oqpi::empty_group_context>(sc, "NestedFork", oqpi::task_priority::inherit, 16);
+    for (auto i = 0; i < 16; ++i)
+    {
+        spFork->addTask(makeNode([&count] { ++count; }));
+    }
+    std::atomic<int32_t> countAfterFork(0);
+    const auto fork = spNested->addNode(oqpi::task_handle(spFork));
+    const auto join = spNested->addNode(makeNode([&count, &countAfterFork] { countAfterFork = count.load(); }));
+    spNested->addEdge(fork, join);
+    sc.add(oqpi::task_handle(spNested)).wait();
+    CHECK(countAfterFork.load() == 16);
+
+    sc.stop();
+
+    // Debug path, runs the nodes on the calling thread in a topological order
+    order.clear();
+    auto spSingle = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "SingleThreaded", oqpi::task_priority::normal);
+    for (auto i = 0; i < 4; ++i)
+    {
+        spSingle->addNode(makeNode([&order, i] { order.push_back(i); }));
+    }
+    spSingle->addEdge(3, 1);
+    spSingle->addEdge(1, 0);
+    spSingle->addEdge(0, 2);
+    spSingle->executeSingleThreaded();
+    CHECK(spSingle->isDone());
+    CHECK(order == std::vector<int32_t>{ 3, 1, 0, 2 });
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_task_graph_helpers()
+{
+    TEST_FUNC;
+
+    std::atomic<int32_t> count(0);
+    auto spGraph = oqpi_tk::make_task_graph<oqpi::task_type::waitable>("Graph");
+    const auto a = spGraph->addNode(oqpi_tk::make_task_item("A", [&count] { ++count; }));
+    const auto b = spGraph->addNode(oqpi_tk::make_task_item("B", [&count] { ++count; }));
+    const auto c = spGraph->addNode(oqpi_tk::make_task_item("C", [&count] { count = count * 10; }));
+    spGraph->addEdge(a, c);
+    spGraph->addEdge(b, c);
+    oqpi_tk::schedule_task(oqpi::task_handle(spGraph)).wait();
+    CHECK(count.load() == 20);
+}
+
+//--------------------------------------------------------------------------------------------------
+// Counts the tasks executed by the workers
+std::atomic<int32_t> gWorkerExecutedCount(0);
+struct executed_count_context
+    : public oqpi::worker_context_base
+{
+    executed_count_context(oqpi::worker_base *pOwner)
+        : oqpi::worker_context_base(pOwner)
+    {}
+
+    void onPostExecute(const oqpi::task_handle &) { ++gWorkerExecutedCount; }
+};
+
+//--------------------------------------------------------------------------------------------------
+void test_task_graph_placement()
+{
+    TEST_FUNC;
+
+    // Worker 0 only works on high priority tasks, worker 1 on the others
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config configs[2];
+    configs[0].workerPrio = oqpi::worker_priority::wprio_high;
+    configs[1].workerPrio = oqpi::worker_priority::wprio_normal_or_low;
+    sc.registerWorkers<oqpi::thread_interface<>, oqpi::default_notifier, oqpi::worker_context_container<worker_index_context, executed_count_context>>(configs);
+    sc.start();
+
+    const auto makeNode = [](oqpi::task_priority prio, std::function<void()> f)
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "GraphNode", prio, std::move(f)
+        ));
+    };
+
+    // A chain where no node can run inline on the worker that finished its predecessor
+    constexpr auto nodeCount = 5;
+    std::vector<int32_t> workers(nodeCount, -1);
+    std::vector<bool> onFiber(nodeCount, false);
+    const oqpi::task_priority priorities[nodeCount] =
+    {
+        oqpi::task_priority::high,  // Worker 0
+        oqpi::task_priority::low,   // Priority worker 0 does not work on
+        oqpi::task_priority::low,   // Runs on a fiber
+        oqpi::task_priority::high,  // Worker 0
+        oqpi::task_priority::high,  // Pinned to worker 1
+    };
+    auto spGraph = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "Placement", oqpi::task_priority::normal, nodeCount);
+    for (auto i = 0; i < nodeCount; ++i)
+    {
+        auto hNode = makeNode(priorities[i], [&workers, &onFiber, i]
+        {
+            workers[i] = tlsWorkerIndex;
+            onFiber[i] = oqpi::this_thread_fiber() != nullptr;
+        });
+        if (i == 2)
+        {
+            hNode.setRunOnFiber(true);
+        }
+        if (i == 4)
+        {
+            hNode.setWorkerAffinity(1);
+        }
+        spGraph->addNode(std::move(hNode));
+        if (i > 0)
+        {
+            spGraph->addEdge(i - 1, i);
+        }
+    }
+    sc.add(oqpi::task_handle(spGraph)).wait();
+    CHECK(workers == std::vector<int32_t>{ 0, 1, 1, 0, 1 });
+    CHECK(onFiber == std::vector<bool>{ false, false, true, false, false });
+
+    // Nodes running inline still go through the worker: contexts and deadlines
+    constexpr auto chainLength = 8;
+    std::atomic<int32_t> count(0);
+    auto spChain = oqpi::make_task_graph<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "InlineChain", oqpi::task_priority::normal, chainLength);
+    spChain->setDeadline(std::chrono::steady_clock::now() + std::chrono::hours(1));
+    for (auto i = 0; i < chainLength; ++i)
+    {
+        spChain->addNode(makeNode(oqpi::task_priority::inherit, [&count] { ++count; }));
+        if (i > 0)
+        {
+            spChain->addEdge(i - 1, i);
+        }
+    }
+    // The worker context of the previous graph may still be running after its wait returned
+    CHECK(sc.waitIdleFor(std::chrono::seconds(1)));
+    sc.resetDeadlineStats();
+    gWorkerExecutedCount = 0;
+    sc.add(oqpi::task_handle(spChain)).wait();
+    CHECK(count.load() == chainLength);
+    CHECK(sc.waitIdleFor(std::chrono::seconds(1)));
+    // The nodes and the graph itself
+    CHECK(gWorkerExecutedCount.load() == chainLength + 1);
+    CHECK(sc.deadlineStats().count >= uint64_t(chainLength));
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Task graph.", "[scheduling]")
+{
+    test_task_graph();
+    test_task_graph_helpers();
+    test_task_graph_placement();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_rearm()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 4;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    std::atomic<int32_t> count(0);
+    const auto makeTask = [&count]
+    {
+        return oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "FrameTask", oqpi::task_priority::inherit, [&count] { ++count; }
+        ));
+    };
+
+    // Built once: sequence( fork(16), graph(diamond), task )
+    auto spFrame = oqpi::make_sequence_group<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "Frame", oqpi::task_priority::normal);
+    auto spFork = oqpi::make_parallel_group<oqpi::task_type::fire_and_forget, oqpi::empty_group_context>(sc, "FrameFork", oqpi::task_priority::inherit, 16, 4);
+    for (auto i = 0; i < 16; ++i)
+    {
+        spFork->addTask(makeTask());
+    }
+    auto spGraph = oqpi::make_task_graph<oqpi::task_type::fire_and_forget, oqpi::empty_group_context>(sc, "FrameGraph", oqpi::task_priority::inherit, 4);
+    const auto top = spGraph->addNode(makeTask());
+    const auto left = spGraph->addNode(makeTask());
+    const auto right = spGraph->addNode(makeTask());
+    const auto bottom = spGraph->addNode(makeTask());
+    spGraph->addEdge(top, left);
+    spGraph->addEdge(top, right);
+    spGraph->addEdge(left, bottom);
+    spGraph->addEdge(right, bottom);
+    std::atomic<int32_t> countAtEndOfFrame(0);
+    spFrame->addTask(oqpi::task_handle(spFork));
+    spFrame->addTask(oqpi::task_handle(spGraph));
+    spFrame->addTask(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "EndOfFrame", oqpi::task_priority::inherit, [&count, &countAtEndOfFrame] { countAtEndOfFrame = count.load(); }
+    )));
+
+    // Then replayed every frame
+    constexpr auto frameCount = 200;
+    auto hFrame = oqpi::task_handle(spFrame);
+    std::atomic<int32_t> continuationCount(0);
+    for (auto frame = 0; frame < frameCount; ++frame)
+    {
+        if (frame > 0)
+        {
+            CHECK(hFrame.isDone());
+            hFrame.rearm();
+            CHECK_FALSE(hFrame.isDone());
+            CHECK_FALSE(hFrame.isGrabbed());
+        }
+        hFrame.addContinuation([&continuationCount] { ++continuationCount; });
+        sc.add(hFrame).wait();
+        CHECK(countAtEndOfFrame.load() == (frame + 1) * 20);
+    }
+    CHECK(count.load() == frameCount * 20);
+    CHECK(continuationCount.load() == frameCount);
+
+    // Unit tasks can be replayed as well, the result is the one of the last run
+    auto spTask = oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "Replayed", oqpi::task_priority::normal, [&count] { return ++count; }
+    );
+    sc.add(oqpi::task_handle(spTask)).wait();
+    const auto firstResult = spTask->getResult();
+    spTask->rearm();
+    sc.add(oqpi::task_handle(spTask)).wait();
+    CHECK(spTask->getResult() == firstResult + 1);
+
+    sc.stop();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Rearm.", "[scheduling]")
+{
+    test_rearm();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_task_references()
+{
+    TEST_FUNC;
+
+    oqpi::scheduler<concurrent_queue> sc;
+    oqpi::worker_config config;
+    config.count = 2;
+    sc.registerWorker<oqpi::thread_interface<>, oqpi::default_notifier>(config);
+    sc.start();
+
+    // A posted task is only referenced by the worker running it
+    std::weak_ptr<oqpi::task_base> wpTask;
+    std::atomic<long> useCount(0);
+    auto spTask = oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "Posted", oqpi::task_priority::normal, [&wpTask, &useCount] { useCount = wpTask.use_count(); }
+    );
+    wpTask = spTask;
+    sc.post(oqpi::task_handle(std::move(spTask)));
+    const auto start = std::chrono::steady_clock::now();
+    while (useCount.load() == 0 && std::chrono::steady_clock::now() - start < std::chrono::seconds(10))
+    {
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    CHECK(useCount.load() == 1);
+
+    // An added task is referenced by the returned handle and the worker running it only, the
+    // queue lets go of it
+    useCount = 0;
+    auto spAdded = oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "Added", oqpi::task_priority::normal, [&wpTask, &useCount] { useCount = wpTask.use_count(); }
+    );
+    wpTask = spAdded;
+    auto hAdded = sc.add(oqpi::task_handle(std::move(spAdded)));
+    hAdded.wait();
+    CHECK(useCount.load() == 2);
+    CHECK(sc.waitIdleFor(std::chrono::seconds(1)));
+    CHECK(wpTask.use_count() == 1);
+
+    // Tasks don't hold a reference to their group, the group holds one on itself instead
+    std::atomic<int32_t> count(0);
+    auto spGroup = oqpi::make_parallel_group<oqpi::task_type::waitable, oqpi::empty_group_context>(sc, "References", oqpi::task_priority::normal, 16);
+    CHECK(spGroup.use_count() == 1);
+    for (auto i = 0; i < 16; ++i)
+    {
+        spGroup->addTask(oqpi::task_handle(oqpi::make_task<oqpi::task_type::fire_and_forget, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+        (
+            "Child", oqpi::task_priority::inherit, [&count] { ++count; }
+        )));
+    }
+    CHECK(spGroup.use_count() == 2);
+
+    // Which keeps it alive once we let it go
+    std::weak_ptr<oqpi::task_base> wpGroup = spGroup;
+    auto hDone = oqpi::task_handle(spGroup).then(sc, oqpi::task_handle(oqpi::make_task<oqpi::task_type::waitable, oqpi::manual_reset_event_interface<>, oqpi::empty_task_context>
+    (
+        "Done", oqpi::task_priority::normal, [] {}
+    )));
+    sc.post(oqpi::task_handle(std::move(spGroup)));
+    hDone.wait();
+    CHECK(count.load() == 16);
+
+    sc.stop();
+    CHECK(wpGroup.expired());
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Task references.", "[scheduling]")
+{
+    test_task_references();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Records the names of the tasks it's attached to, which forces them to be materialized
+std::mutex gTaskNamesMutex;
+std::vector<std::string> gTaskNames;
+struct task_name_context
+    : public oqpi::task_context_base
+{
+    task_name_context(oqpi::task_base *pOwner, const std::string &name)
+        : oqpi::task_context_base(pOwner, name)
+    {
+        std::lock_guard<std::mutex> __l(gTaskNamesMutex);
+        gTaskNames.push_back(name);
+    }
+};
+
+//--------------------------------------------------------------------------------------------------
+// Counts the allocations made by the calling thread while enabled
+thread_local bool    tlsCountAllocations = false;
+thread_local int64_t tlsAllocationCount  = 0;
+void* operator new(std::size_t size)
+{
+    if (tlsCountAllocations)
+    {
+        ++tlsAllocationCount;
+    }
+    if (auto p = std::malloc(size > 0 ? size : 1))
+    {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+// Inlined into the callers, GCC can't tell that new is replaced as well
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic push
+#   pragma GCC diagnostic ignored "-Wmismatched-new-delete"
+#endif
+void operator delete(void *p) noexcept
+{
+    std::free(p);
+}
+void operator delete(void *p, std::size_t) noexcept
+{
+    std::free(p);
+}
+#if defined(__GNUC__) && !defined(__clang__)
+#   pragma GCC diagnostic pop
+#endif
+
+//--------------------------------------------------------------------------------------------------
+// Allocations made to build a parallel_for group and run it on the calling thread
+template<typename _Toolkit>
+int64_t parallel_for_allocations(std::string_view name)
+{
+    std::atomic<int32_t> count(0);
+    tlsAllocationCount  = 0;
+    tlsCountAllocations = true;
+    {
+        auto spGroup = _Toolkit::template make_parallel_for_task_group<oqpi::task_type::waitable>(name, oqpi::simple_partitioner(64, 8), oqpi::task_priority::normal, [&count](int32_t) { ++count; });
+        spGroup->executeSingleThreaded();
+    }
+    tlsCountAllocations = false;
+    CHECK(count.load() == 64);
+    return tlsAllocationCount;
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_task_names()
+{
+    TEST_FUNC;
+
+    CHECK(oqpi::task_name().empty());
+    CHECK(oqpi::task_name("Plain").str() == "Plain");
+    CHECK(oqpi::task_name(std::string("Owned")).str() == "Owned");
+    CHECK(oqpi::task_name("Batch ", 3, "/", 8).str() == "Batch 3/8");
+    CHECK(oqpi::task_name(std::string_view("Loop"), " (", 1024, " items)").str() == "Loop (1024 items)");
+
+    // Names are only built for contexts asking for them
+    gTaskNames.clear();
+    using names_tk = oqpi::helpers<oqpi::scheduler<concurrent_queue>, oqpi::empty_group_context, oqpi::task_context_container<task_name_context>>;
+    std::atomic<int32_t> count(0);
+    auto spGroup = names_tk::make_parallel_for_task_group<oqpi::task_type::waitable>("Names", oqpi::simple_partitioner(8, 4), oqpi::task_priority::normal, [&count](int32_t) { ++count; });
+    spGroup->executeSingleThreaded();
+    CHECK(count.load() == 8);
+    CHECK(gTaskNames.size() == 4);
+    CHECK(std::find(gTaskNames.begin(), gTaskNames.end(), "Batch 2/4") != gTaskNames.end());
+
+    // A name too long for the small string buffer costs an allocation once it's built, which
+    // only the contexts asking for names do. The default toolkit never builds any.
+    constexpr auto longName = std::string_view("A parallel_for name way too long for the small string buffer");
+    CHECK(parallel_for_allocations<names_tk>("L") < parallel_for_allocations<names_tk>(longName));
+    CHECK(parallel_for_allocations<oqpi::default_helpers>("L") == parallel_for_allocations<oqpi::default_helpers>(longName));
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Task names.", "[scheduling]")
+{
+    test_task_names();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Stands in for a worker, naps instead of parking and counts the calls
+struct counting_wait_helper
+    : public oqpi::wait_helper
+{
+    virtual bool helpOnce() override { return false; }
+    virtual void notifyWhenDone(oqpi::task_base &) override { ++notifyCount; }
+    virtual void park(oqpi::task_base &) override
+    {
+        ++parkCount;
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+
+    int32_t notifyCount = 0;
+    int32_t parkCount   = 0;
+};
+
+//--------------------------------------------------------------------------------------------------
+void test_help_while_waiting()
+{
+    TEST_FUNC;
+
+    // A single worker, any task waiting for another one would block it forever
+    using help_tk = oqpi::helpers<oqpi::scheduler<concurrent_queue>>;
+    help_tk::start_default_scheduler(1);
+
+    auto hOuter = help_tk::schedule_task("Outer", []
+    {
+        auto hInner = help_tk::schedule_task("Inner", [] { return 42; });
+        hInner.wait();
+        return hInner.isDone();
+    });
+    hOuter.wait();
+    CHECK(hOuter.isDone());
+
+    // Nested groups of every kind waited for from the worker
+    std::atomic<int32_t> count(0);
+    auto hNested = help_tk::schedule_task("Nested", [&count]
+    {
+        help_tk::parallel_for("Inner loop", 16, [&count](int32_t) { ++count; });
+
+        auto spSequence = help_tk::make_sequence_group<oqpi::task_type::waitable>("Inner sequence");
+        for (auto i = 0; i < 4; ++i)
+        {
+            spSequence->addTask(help_tk::make_task_item("Step", [&count] { ++count; }));
+        }
+        help_tk::schedule_task(oqpi::task_handle(spSequence)).wait();
+
+        auto spGraph = help_tk::make_task_graph<oqpi::task_type::waitable>("Inner graph");
+        const auto a = spGraph->addNode(help_tk::make_task_item("A", [&count] { ++count; }));
+        const auto b = spGraph->addNode(help_tk::make_task_item("B", [&count] { ++count; }));
+        spGraph->addEdge(a, b);
+        help_tk::schedule_task(oqpi::task_handle(spGraph)).wait();
+    });
+    hNested.wait();
+    CHECK(count.load() == 16 + 4 + 2);
+
+    help_tk::stop_scheduler();
+
+    // Not started, the calling thread runs the whole sequence itself
+    count = 0;
+    auto spSequence = help_tk::make_sequence_group<oqpi::task_type::waitable>("Active wait");
+    for (auto i = 0; i < 4; ++i)
+    {
+        spSequence->addTask(help_tk::make_task_item("Step", [&count] { ++count; }));
+    }
+    oqpi::task_handle(spSequence).activeWait();
+    CHECK(count.load() == 4);
+
+    // Nothing to help with: the waiting worker sleeps instead of spinning until the task is done
+    oqpi::toolkit<oqpi::scheduler<concurrent_queue>> sleepy;
+    sleepy.start_default_scheduler(2);
+    auto hWaiter = sleepy.make_task("Waiter", [&sleepy]
+    {
+        std::atomic<bool> started(false);
+        auto hSlow = oqpi::task_handle(sleepy.make_task("Slow", [&started]
+        {
+            started = true;
+            oqpi::this_thread::sleep_for(std::chrono::milliseconds(200));
+        }));
+        hSlow.setWorkerAffinity(1);
+        sleepy.schedule_task(hSlow);
+        // Running on the other worker already, the waiter can't run it itself
+        while (!started.load())
+        {
+            oqpi::this_thread::yield();
+        }
+
+        const auto cpuStart = thread_cpu_time();
+        hSlow.wait();
+        return thread_cpu_time() - cpuStart;
+    });
+    hWaiter->setWorkerAffinity(0);
+    sleepy.schedule_task(oqpi::task_handle(hWaiter)).wait();
+    CHECK(hWaiter->getResult() < 50.0);
+
+    // Parking over and over during a long wait only registers one wake up
+    std::atomic<bool> started(false);
+    auto hLong = sleepy.schedule_task("Long", [&started]
+    {
+        started = true;
+        oqpi::this_thread::sleep_for(std::chrono::milliseconds(100));
+    });
+    while (!started.load())
+    {
+        oqpi::this_thread::yield();
+    }
+    counting_wait_helper helper;
+    oqpi::this_thread_wait_helper() = &helper;
+    hLong.wait();
+    oqpi::this_thread_wait_helper() = nullptr;
+    CHECK(helper.parkCount > 1);
+    CHECK(helper.notifyCount == 1);
+    sleepy.stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Help while waiting.", "[scheduling]")
+{
+    test_help_while_waiting();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_fibers()
+{
+    TEST_FUNC;
+
+    // A single worker, tasks waiting from their fiber let it run the others instead of nesting
+    // them on its stack
+    using fiber_tk = oqpi::helpers<oqpi::work_stealing_scheduler<oqpi::ring_queue>>;
+    fiber_tk::start_default_scheduler(1);
+
+    std::atomic<int32_t> count(0);
+    std::atomic<int32_t> nested(0);
+    const auto makeInner = [&count, &nested]
+    {
+        return fiber_tk::schedule_task("Inner", [&count, &nested]
+        {
+            // Not run from within a wait
+            nested += oqpi::this_thread_help_depth();
+            ++count;
+        });
+    };
+
+    auto hOuter = fiber_tk::make_task<oqpi::task_type::waitable>("Outer", oqpi::task_priority::normal, [&makeInner]
+    {
+        const auto pFiber = oqpi::this_thread_fiber();
+        makeInner().wait();
+        makeInner().wait();
+        return pFiber != nullptr;
+    });
+    oqpi::task_handle(hOuter).setRunOnFiber(true);
+    fiber_tk::schedule_task(oqpi::task_handle(hOuter)).wait();
+    CHECK(hOuter->getResult());
+    CHECK(count.load() == 2);
+
+    // Children of a group running on fibers, each one suspended while waiting on the others
+    count = 0;
+    const auto taskCount = 32;
+    std::vector<oqpi::task_handle> handles(taskCount);
+    auto spFork = fiber_tk::make_parallel_group<oqpi::task_type::waitable>("Fork", oqpi::task_priority::normal, taskCount);
+    for (auto i = 0; i < taskCount; ++i)
+    {
+        handles[i] = fiber_tk::make_task<oqpi::task_type::waitable>("Step", oqpi::task_priority::normal, [&handles, &makeInner, i]
+        {
+            makeInner().wait();
+            if (i > 0)
+            {
+                handles[i - 1].wait();
+            }
+        });
+        spFork->addTask(handles[i]);
+    }
+    oqpi::task_handle hFork(spFork);
+    hFork.setRunOnFiber(true);
+    fiber_tk::schedule_task(hFork).wait();
+    CHECK(count.load() == taskCount);
+    CHECK(nested.load() == 0);
+
+    fiber_tk::stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Fibers.", "[scheduling]")
+{
+    test_fibers();
+}
+
+//--------------------------------------------------------------------------------------------------
+// Counts its copies, can't be default constructed
+struct copy_counter
+{
+    explicit copy_counter(int32_t v) : value(v) {}
+    copy_counter(const copy_counter &other) : value(other.value) { ++copies(); }
+    copy_counter(copy_counter &&other) = default;
+    copy_counter& operator =(const copy_counter &other) { value = other.value; ++copies(); return *this; }
+    copy_counter& operator =(copy_counter &&other) = default;
+
+    static std::atomic<int32_t>& copies()
+    {
+        static std::atomic<int32_t> count(0);
+        return count;
+    }
+
+    int32_t value;
+};
+
+//--------------------------------------------------------------------------------------------------
+void test_task_futures()
+{
+    TEST_FUNC;
+
+    // Move only results, taken once
+    auto buffer = oqpi_tk::schedule_future("Buffer", []
+    {
+        return std::make_unique<std::vector<int32_t>>(1024, 7);
+    });
+    CHECK(buffer.get()->size() == 1024);
+    auto upBuffer = buffer.take();
+    REQUIRE(upBuffer != nullptr);
+    CHECK((*upBuffer)[1023] == 7);
+
+    // Results are never copied on the way
+    copy_counter::copies() = 0;
+    auto counter = oqpi_tk::schedule_future("Counter", oqpi::task_priority::high, [](int32_t v) { return copy_counter(v); }, 42);
+    CHECK(counter.get().value == 42);
+    const auto &ref = counter.get();
+    CHECK(ref.value == 42);
+    CHECK(counter.take().value == 42);
+    CHECK(copy_counter::copies().load() == 0);
+
+    // Futures of existing tasks, void ones included
+    auto spTask = oqpi_tk::make_task("Void", [] {});
+    oqpi::task_future<void> done(spTask);
+    oqpi_tk::schedule_task(done.getHandle());
+    done.get();
+    CHECK(done.isDone());
+
+    // Copies of a future taken from several threads at once: one of them gets the result
+    constexpr auto takerCount = 4;
+    for (auto round = 0; round < 50; ++round)
+    {
+        auto shared = oqpi_tk::schedule_future("Shared", [] { return std::make_unique<int32_t>(7); });
+        shared.wait();
+
+        std::atomic<bool>    go(false);
+        std::atomic<int32_t> winners(0);
+        std::atomic<int32_t> losers(0);
+        std::vector<oqpi::thread> takers;
+        for (auto t = 0; t < takerCount; ++t)
+        {
+            takers.emplace_back("Taker", [future = shared, &go, &winners, &losers]() mutable
+            {
+                while (!go.load())
+                {
+                    oqpi::this_thread::yield();
+                }
+                try
+                {
+                    winners += *future.takeReady() == 7 ? 1 : 0;
+                }
+                catch (const oqpi::no_result_error &)
+                {
+                    ++losers;
+                }
+            });
+        }
+        go = true;
+        for (auto &th : takers)
+        {
+            th.join();
+        }
+        CHECK(winners.load() == 1);
+        CHECK(losers.load() == takerCount - 1);
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Task futures.", "[scheduling]")
+{
+    test_task_futures();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_cancellation()
+{
+    TEST_FUNC;
+
+    // Cancelled before being scheduled: done without running
+    std::atomic<int32_t> ran(0);
+    auto token = oqpi::make_cancellation_token();
+    token.cancel();
+    auto hTask = oqpi::task_handle(oqpi_tk::make_task("Cancelled", [&ran] { ++ran; }));
+    hTask.setCancellationToken(token);
+    oqpi_tk::schedule_task(hTask).wait();
+    CHECK(hTask.isDone());
+    CHECK(hTask.isCancelled());
+    CHECK(ran.load() == 0);
+
+    // The future of a cancelled task has no result to read, checks enabled or not
+    auto spCancelled = oqpi_tk::make_task("Cancelled future", [] { return std::make_unique<int32_t>(7); });
+    oqpi::task_future<std::unique_ptr<int32_t>> cancelledFuture(spCancelled);
+    spCancelled->setCancellationToken(token);
+    oqpi_tk::schedule_task(cancelledFuture.getHandle());
+    cancelledFuture.wait();
+    CHECK(cancelledFuture.isDone());
+    CHECK(cancelledFuture.isCancelled());
+    CHECK_FALSE(cancelledFuture.hasResult());
+    CHECK_THROWS_AS(cancelledFuture.get(), oqpi::no_result_error);
+    CHECK_THROWS_AS(cancelledFuture.take(), oqpi::no_result_error);
+
+    // The remaining tasks of a group are not scheduled once it's cancelled
+    const auto cancelFirst = [](const auto &spGroup, const oqpi::cancellation_token &groupToken, std::atomic<int32_t> &count, std::vector<oqpi::task_handle> &tasks)
+    {
+        spGroup->setCancellationToken(groupToken);
+        for (auto i = 0; i < 8; ++i)
+        {
+            tasks.push_back(oqpi_tk::make_task_item("Item", [&count, groupToken] { ++count; groupToken.cancel(); }));
+            spGroup->addTask(tasks.back());
+        }
+        oqpi_tk::schedule_task(oqpi::task_handle(spGroup)).wait();
+        CHECK(count.load() == 1);
+        CHECK(std::all_of(tasks.begin(), tasks.end(), [](const oqpi::task_handle &h) { return h.isDone(); }));
+    };
+
+    {
+        std::atomic<int32_t> count(0);
+        std::vector<oqpi::task_handle> tasks;
+        cancelFirst(oqpi_tk::make_parallel_group<oqpi::task_type::waitable>("Fork", oqpi::task_priority::normal, 8, 1), oqpi::make_cancellation_token(), count, tasks);
+    }
+    {
+        std::atomic<int32_t> count(0);
+        std::vector<oqpi::task_handle> tasks;
+        cancelFirst(oqpi_tk::make_sequence_group<oqpi::task_type::waitable>("Sequence"), oqpi::make_cancellation_token(), count, tasks);
+    }
+
+    // Loops stop taking ranges
+    {
+        std::atomic<int32_t> count(0);
+        auto loopToken = oqpi::make_cancellation_token();
+        const auto partitioner = oqpi::atomic_partitioner(100000, 1, 4);
+        auto spLoop = oqpi_tk::make_parallel_for_task_group<oqpi::task_type::waitable>("Loop", partitioner, oqpi::task_priority::normal, [&count, loopToken](int32_t)
+        {
+            if (++count == 100)
+            {
+                loopToken.cancel();
+            }
+        });
+        spLoop->setCancellationToken(loopToken);
+        oqpi_tk::schedule_task(oqpi::task_handle(spLoop)).wait();
+        CHECK(count.load() >= 100);
+        CHECK(count.load() < 100 + 4);
+    }
+
+    // Long running bodies poll the token
+    {
+        auto bodyToken = oqpi::make_cancellation_token();
+        auto hPoll = oqpi_tk::schedule_task("Poll", [bodyToken]
+        {
+            while (!bodyToken.isCancelled())
+            {
+                oqpi::this_thread::yield();
+            }
+        });
+        bodyToken.cancel();
+        hPoll.wait();
+        CHECK(hPoll.isDone());
+    }
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Cancellation.", "[scheduling]")
+{
+    test_cancellation();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_quiescence()
+{
+    TEST_FUNC;
+
+    auto &sc = oqpi_tk::scheduler();
+
+    // Nothing to wait on but the scheduler: tasks spawning others, none of them waitable
+    std::atomic<int32_t> count(0);
+    for (auto i = 0; i < 16; ++i)
+    {
+        oqpi_tk::schedule_task(oqpi_tk::make_task_item("Spawner", [&count]
+        {
+            for (auto j = 0; j < 8; ++j)
+            {
+                oqpi_tk::schedule_task(oqpi_tk::make_task_item("Child", [&count] { ++count; }));
+            }
+            ++count;
+        }));
+    }
+    sc.waitIdle();
+    CHECK(count.load() == 16 * 9);
+    CHECK(sc.isIdle());
+    CHECK(sc.inFlightCount() == 0);
+
+    // Running tasks count as well
+    std::atomic<bool> release(false);
+    oqpi_tk::schedule_task(oqpi_tk::make_task_item("Blocker", [&release]
+    {
+        while (!release.load())
+        {
+            oqpi::this_thread::yield();
+        }
+    }));
+    CHECK_FALSE(sc.waitIdleFor(std::chrono::milliseconds(10)));
+    CHECK(sc.inFlightCount() > 0);
+    release = true;
+    sc.waitIdle();
+    CHECK(sc.isIdle());
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Quiescence.", "[scheduling]")
+{
+    test_quiescence();
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_toolkit_instances()
+{
+    TEST_FUNC;
+
+    // Two toolkits of the same type, each with its own scheduler and workers
+    using tk_type = oqpi::toolkit<oqpi::scheduler<concurrent_queue>>;
+    tk_type requests;
+    tk_type bulk;
+    requests.start_default_scheduler(1);
+    bulk.start_default_scheduler(2);
+    CHECK(requests.scheduler().workersTotalCount() == 1);
+    CHECK(bulk.scheduler().workersTotalCount() == 2);
+
+    // Every bulk worker is busy, requests still go through
+    std::atomic<bool> release(false);
+    std::atomic<int32_t> bulkCount(0);
+    for (auto i = 0; i < 8; ++i)
+    {
+        bulk.fire_and_forget_task("Bulk", [&release, &bulkCount]
+        {
+            while (!release.load())
+            {
+                oqpi::this_thread::yield();
+            }
+            ++bulkCount;
+        });
+    }
+
+    auto future = requests.schedule_future("Request", [] { return 42; });
+    CHECK(future.get() == 42);
+
+    std::atomic<int32_t> sum(0);
+    requests.parallel_for("Request loop", 100, [&sum](int32_t i) { sum += i; });
+    CHECK(sum.load() == 4950);
+
+    auto hFork = requests.fork_tasks<oqpi::task_type::waitable>("Request fork",
+        requests.make_task_item("A", [&sum] { ++sum; }),
+        requests.make_task_item("B", [&sum] { ++sum; }));
+    hFork.wait();
+    CHECK(sum.load() == 4952);
+
+    CHECK(requests.scheduler().waitIdleFor(std::chrono::seconds(1)));
+    CHECK(bulkCount.load() == 0);
+    CHECK_FALSE(bulk.scheduler().isIdle());
+
+    release = true;
+    bulk.scheduler().waitIdle();
+    CHECK(bulkCount.load() == 8);
+
+    requests.stop_scheduler();
+    bulk.stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Toolkit instances.", "[scheduling]")
+{
+    test_toolkit_instances();
+}
+
+#if OQPI_HAS_COROUTINES
+//--------------------------------------------------------------------------------------------------
+using co_tk = oqpi::helpers<oqpi::scheduler<oqpi::ring_queue>, oqpi::empty_group_context, oqpi::empty_task_context, oqpi::manual_reset_event_interface<>, oqpi::slab_allocator<char>>;
+
+//--------------------------------------------------------------------------------------------------
+inline oqpi::co_task<int32_t> co_step(std::atomic<int32_t> &nested, int32_t value)
+{
+    // Scheduled tasks are awaited without running them from within a wait
+    co_await co_tk::schedule_task("Step", [&nested] { nested += oqpi::this_thread_help_depth(); });
+    co_return value + 1;
+}
+
+//--------------------------------------------------------------------------------------------------
+inline oqpi::co_task<int32_t> co_handler(std::atomic<int32_t> &nested, std::atomic<int32_t> &count)
+{
+    // Chained coroutines run on the same task
+    auto value = 0;
+    for (auto i = 0; i < 8; ++i)
+    {
+        value = co_await co_step(nested, value);
+    }
+
+    // Results of unit tasks
+    auto spTask = co_tk::make_task("Result", [] { return 10; });
+    co_tk::schedule_task(oqpi::task_handle(spTask));
+    value += co_await spTask;
+    value += co_await co_tk::schedule_future("Future", [] { return 5; });
+
+    // Groups and loops
+    auto spFork = co_tk::make_parallel_group<oqpi::task_type::waitable>("Fork", oqpi::task_priority::normal, 4);
+    for (auto i = 0; i < 4; ++i)
+    {
+        spFork->addTask(co_tk::make_task_item("Item", [&count] { ++count; }));
+    }
+    co_tk::schedule_task(oqpi::task_handle(spFork));
+    co_await spFork;
+    co_await co_tk::schedule_parallel_for("Loop", 16, [&count](int32_t) { ++count; });
+
+    co_return value;
+}
+
+//--------------------------------------------------------------------------------------------------
+void test_coroutines()
+{
+    TEST_FUNC;
+
+    // A single worker, every coroutine is suspended while it waits
+    co_tk::start_default_scheduler(1);
+
+    std::atomic<int32_t> nested(0);
+    std::atomic<int32_t> count(0);
+    auto spHandler = co_tk::schedule_coroutine("Handler", co_handler(nested, count));
+    CHECK(spHandler->waitForResult() == 8 + 10 + 5);
+    CHECK(count.load() == 4 + 16);
+
+    // Many coroutines interleaved on the worker
+    const auto coroutineCount = 64;
+    std::vector<oqpi::task_handle> handles;
+    for (auto i = 0; i < coroutineCount; ++i)
+    {
+        handles.emplace_back(co_tk::schedule_coroutine("Handler", oqpi::task_priority::high, co_handler(nested, count)));
+    }
+    for (auto &hTask : handles)
+    {
+        hTask.wait();
+    }
+    CHECK(count.load() == (coroutineCount + 1) * (4 + 16));
+    CHECK(nested.load() == 0);
+
+    co_tk::stop_scheduler();
+}
+
+//--------------------------------------------------------------------------------------------------
+TEST_CASE("Coroutines.", "[scheduling]")
+{
+    test_coroutines();
+}
+#endif
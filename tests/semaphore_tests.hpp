@@ -70,3 +70,27 @@ TEST_CASE("Semaphores.", "[semaphore]")
         REQUIRE(success);
     }
 }
+
+TEST_CASE("Notifier.", "[semaphore]")
+{
+    oqpi::default_notifier notifier;
+
+    auto success = notifier.tryWait(); // Nothing pending.
+    REQUIRE(!success);
+
+    notifier.notifyOne();
+    success = notifier.tryWait(); // Consumes the notification.
+    REQUIRE(success);
+
+    // Wake up a waiting thread
+    std::atomic<bool> woken(false);
+    auto waiter = oqpi::thread("Waiter", [&notifier, &woken]
+    {
+        notifier.wait();
+        woken = true;
+    });
+    oqpi::this_thread::sleep_for(std::chrono::milliseconds(10));
+    notifier.notifyOne();
+    waiter.join();
+    REQUIRE(woken.load());
+}
@@ -60,6 +60,23 @@ double duration(int64_t s, int64_t e)
 #endif
 }
 
+// CPU time used by the calling thread so far, in milliseconds
+double thread_cpu_time()
+{
+#if OQPI_PLATFORM_WIN
+    FILETIME creation, exit, kernel, user;
+    GetThreadTimes(GetCurrentThread(), &creation, &exit, &kernel, &user);
+    const auto toMs = [](const FILETIME &t) { return ((uint64_t(t.dwHighDateTime) << 32) | t.dwLowDateTime) / 1e4; };
+    return toMs(kernel) + toMs(user);
+
+#elif OQPI_PLATFORM_POSIX
+    timespec time;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+    return time.tv_sec * 1e3 + time.tv_nsec / 1e6;
+
+#endif
+}
+
 
 class timing_registry
 {